@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <cstring>
+
+#include "VulkanValidation.hpp"
+
+// Set by the build to where shaders are compiled, otherwise looked for next to the working directory
+#ifndef LV_SHADER_DIR
+#define LV_SHADER_DIR "shaders"
+#endif
+
+// Preferred way of presenting swapchain images (falls back down to FIFO, which is always supported)
+enum class PresentPolicy
+{
+    Fifo,           // VSync, never tears
+    FifoRelaxed,    // VSync, but tears instead of waiting when a frame is late (-> FIFO)
+    Mailbox,        // Newest frame replaces queued one, no tearing and low latency (-> FIFO)
+    Immediate       // No waiting at all, tears, lowest latency (-> MAILBOX -> FIFO)
+};
+
+// What the swapchain image count is chosen for
+enum class SwapchainTarget
+{
+    Latency,        // As few images as the present mode allows, so frames can't queue up
+    Throughput      // One extra image, so the CPU/GPU rarely wait for an image to be free
+};
+
+// When the windowed main loop draws
+enum class RenderLoopMode
+{
+    Continuous,     // Draw every iteration, as fast as presentation allows (benchmarking)
+    OnDemand        // Sleep until input, animation or a data update asks for a redraw
+};
+
+// File format captured frames are written in
+enum class CaptureFormat
+{
+    Png,            // Uncompressed PNG, viewable anywhere
+    Raw             // Pixels as read back behind an LVRI header, cheapest to write
+};
+
+// Read a present policy by name (fifo, fifo-relaxed, mailbox, immediate), returns false if name isn't recognised
+static bool parsePresentPolicy(const char* name, PresentPolicy& policy)
+{
+    struct { const char* name; PresentPolicy policy; } policies[] = {
+        { "fifo", PresentPolicy::Fifo },
+        { "fifo-relaxed", PresentPolicy::FifoRelaxed },
+        { "mailbox", PresentPolicy::Mailbox },
+        { "immediate", PresentPolicy::Immediate }
+    };
+
+    for (const auto& entry : policies)
+    {
+        if (strcmp(name, entry.name) == 0)
+        {
+            policy = entry.policy;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Options chosen by the application before the renderer is initialised
+struct RendererConfig
+{
+    // -- HEADLESS --
+    bool headless = false;                  // Run without a window (e.g. build servers with lavapipe)
+    bool useHeadlessSurface = false;        // Create a VK_EXT_headless_surface (if supported) instead of having no surface at all
+    uint32_t offscreenWidth = 800;          // Size of offscreen render images when there is no surface
+    uint32_t offscreenHeight = 600;
+    uint32_t offscreenImageCount = 2;       // Number of offscreen images to rotate through when there is no surface
+
+    // -- DEVICE SELECTION --
+    std::string deviceOverride;             // Force a device by index or (part of) name, LV_DEVICE environment variable takes priority
+    bool deviceBenchmark = false;           // Run a short benchmark to break ties between similarly scored devices
+    int deviceTieRange = 50;                // Devices within this many points of the best are considered tied
+
+    // -- QUEUES --
+    float graphicsQueuePriority = 1.0f;     // Relative priority of each queue (0 = lowest, 1 = highest)
+    float computeQueuePriority = 0.5f;
+    float transferQueuePriority = 0.5f;
+
+    // -- SWAPCHAIN --
+    PresentPolicy presentPolicy = PresentPolicy::Mailbox;       // LV_PRESENT_MODE environment variable takes priority
+    SwapchainTarget swapchainTarget = SwapchainTarget::Latency;
+
+    // -- FRAMES --
+    uint32_t framesInFlight = 2;            // Frames the CPU can record ahead of the GPU (1-4), more = smoother, fewer = less latency
+    uint32_t headlessFrameCount = 100;      // Frames to render before exiting when there is no window
+    size_t uploadArenaSize = 4 * 1024 * 1024;   // Per frame in flight, for uniforms and dynamic vertex/instance data
+    RenderLoopMode loopMode = RenderLoopMode::Continuous;
+    double idleWaitTimeout = 0.5;           // Longest an on-demand loop sleeps without events, in seconds
+
+    // -- GEOMETRY --
+    bool vertexPulling = true;              // Draw the scene by reading vertices through buffer device addresses (needs bufferDeviceAddress and dynamic rendering)
+    std::string shaderDirectory = LV_SHADER_DIR;    // Compiled SPIR-V (geometry.vert.spv, geometry.frag.spv) is loaded from here
+    size_t geometryBufferSize = 4 * 1024 * 1024;    // Static vertex and index data for every mesh
+
+    // -- CAPTURE --
+    std::string capturePath;                // Write frames to <capturePath>_<frame>.png/.lvri (empty = don't capture)
+    CaptureFormat captureFormat = CaptureFormat::Png;
+    uint32_t captureInterval = 1;           // Capture every Nth frame
+    uint32_t maxPendingCaptures = 4;        // Frames copied out and waiting to be encoded, later captures are dropped
+
+    // -- DYNAMIC RESOLUTION --
+    bool dynamicResolution = true;          // Scale the scene resolution from GPU frame time (false = always maxResolutionScale)
+    float minResolutionScale = 0.5f;        // Scene size as a fraction of the output size on each axis
+    float maxResolutionScale = 1.0f;
+    double gpuFrameBudgetMs = 16.0;         // GPU time per frame the scale is adjusted to stay within
+
+    // -- LATENCY --
+    bool limitLatency = true;               // Delay the start of each frame so frames don't queue up ahead of the display
+    uint32_t maxQueuedFrames = 1;           // Frames allowed between the CPU and the display (no more than framesInFlight)
+
+    // -- MEMORY --
+    float memoryBudgetThreshold = 0.9f;     // Fraction of a heap's budget above which streaming resources are evicted
+    float memoryBudgetTarget = 0.8f;        // Fraction of the budget evicted down to
+    uint32_t poolMaxIdleFrames = 120;       // Pooled transient resources unused for this many frames are destroyed
+    bool hostAllocationCallbacks = true;    // Route driver host allocations through HostAllocator (false = driver's own malloc)
+
+    // -- STARTUP --
+    bool parallelStartup = true;            // Overlap independent start up stages on worker threads (false = one after another)
+
+    // -- VALIDATION --
+    ValidationLevel validationLevel = defaultValidationLevel;  // LV_VALIDATION environment variable takes priority
+    size_t performanceWarningReportCount = 10;              // Most frequent performance warnings to report in stats and at shutdown
+
+    // -- PROFILING --
+    std::string tracePath;                  // Write a Chrome trace of startup stages here (empty = don't), LV_TRACE_FILE environment variable takes priority
+};
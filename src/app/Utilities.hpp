@@ -1,19 +1,55 @@
 #pragma once
 
+#include "GpuAllocator.hpp"
+#include "ResidencyManager.hpp"
+#include "ResourcePool.hpp"
+#include "StagingManager.hpp"
+#include "UploadArena.hpp"
+
 const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// Enabled when the device has them, features that depend on them fall back otherwise
+const std::vector<const char*> optionalPresentationExtensions = {
+    VK_KHR_PRESENT_ID_EXTENSION_NAME,
+    VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
+    VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME
+};
+
+// Enabled when the device has them, texture uploads go through staging buffers otherwise
+const std::vector<const char*> optionalUploadExtensions = {
+    VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME
+};
+
+// Enabled when the device has them, device memory use is estimated from the allocator otherwise
+const std::vector<const char*> optionalMemoryExtensions = {
+    VK_EXT_MEMORY_BUDGET_EXTENSION_NAME
+};
+
 // Indices (locations) of Queue Families (if they exist at all)
 struct QueueFamilyIndices
 {
     int graphicsFamily = -1;        // Location of Graphics Queue Family
     int presentationFamily = -1;    // Location of Presentation Queue Family
+    int computeFamily = -1;         // Location of Compute Queue Family (dedicated if possible, otherwise shared with graphics)
+    int transferFamily = -1;        // Location of Transfer Queue Family (dedicated if possible, otherwise shared with compute/graphics)
+
+    // Check if queue families are valid (presentation is only needed when rendering to a surface)
+    bool isValid(bool needsPresentation = true)
+    {
+        return graphicsFamily >= 0 && (!needsPresentation || presentationFamily >= 0);
+    }
 
-    // Check if queue families are valid
-    bool isValid()
+    // Check if compute/transfer work can run alongside graphics work on its own family
+    bool hasDedicatedCompute() const
     {
-        return graphicsFamily >= 0 && presentationFamily >= 0;
+        return computeFamily >= 0 && computeFamily != graphicsFamily;
+    }
+
+    bool hasDedicatedTransfer() const
+    {
+        return transferFamily >= 0 && transferFamily != graphicsFamily && transferFamily != computeFamily;
     }
 };
 
@@ -22,4 +58,235 @@ struct SwapChainDetails
     VkSurfaceCapabilitiesKHR surfaceCapabilities;       // Surface properties, e.g. image size/extent
     std::vector<VkSurfaceFormatKHR> formats;            // Surface image formats, e.g. RGBA and size of each color
     std::vector<VkPresentModeKHR> presentationModes;    // How images should be presented to screen
-};
\ No newline at end of file
+};
+
+// Vulkan version and optional features enabled on the logical device (false if the driver doesn't support them)
+struct DeviceFeatures
+{
+    uint32_t apiVersion = VK_API_VERSION_1_0;   // Version usable on the device (lowest of instance and device versions)
+
+    // -- VULKAN 1.1 --
+    bool storageBuffer16BitAccess = false;
+
+    // -- VULKAN 1.2 --
+    bool storageBuffer8BitAccess = false;
+    bool shaderInt8 = false;
+    bool shaderFloat16 = false;
+    bool timelineSemaphore = false;
+    bool bufferDeviceAddress = false;
+    bool descriptorIndexing = false;
+
+    // -- VULKAN 1.3 --
+    bool synchronization2 = false;
+    bool dynamicRendering = false;
+
+    // -- EXTENSIONS --
+    bool presentId = false;
+    bool presentWait = false;
+    bool swapchainMaintenance1 = false;
+    bool memoryBudget = false;
+    bool hostImageCopy = false;
+};
+
+// Performance warning from the validation layers, and how often it was raised
+struct PerformanceWarningStats
+{
+    int32_t messageId;
+    std::string name;
+    uint64_t runTotal;
+    uint32_t lastFrameTotal;
+};
+
+// Budget and usage of one device memory heap
+struct MemoryHeapStats
+{
+    VkDeviceSize size;
+    VkDeviceSize budget;
+    VkDeviceSize usage;
+    bool deviceLocal;
+};
+
+// Driver host memory in one allocation scope
+struct HostScopeStats
+{
+    const char* scope;
+    uint64_t allocations;           // Over the whole run
+    uint64_t liveAllocations;
+    size_t bytes;
+    size_t highWater;
+    size_t internalBytes;           // Allocated by the driver itself, reported through notifications
+};
+
+// Renderer metrics, for logging or on-screen display
+struct RendererStats
+{
+    // -- FRAMES --
+    uint64_t framesRendered = 0;
+    uint32_t framesInFlight = 0;
+    uint32_t swapchainRecreations = 0;
+    uint32_t pendingDeletions = 0;          // Objects waiting for the frames using them to finish
+    uint64_t pooledResourcesCreated = 0;
+    uint64_t pooledResourcesReused = 0;
+    uint32_t pooledResourcesIdle = 0;       // Released, waiting to be reused or aged out
+
+    // -- MEMORY --
+    uint32_t deviceMemoryAllocations = 0;   // Live vkAllocateMemory allocations
+    uint32_t memoryBlocks = 0;
+    uint32_t dedicatedAllocations = 0;
+    VkDeviceSize memoryReserved = 0;        // Allocated from the driver
+    VkDeviceSize memoryUsed = 0;            // Handed out to resources
+    bool memoryBudgetQueried = false;       // Heap budgets from VK_EXT_memory_budget (false = estimated)
+    std::vector<MemoryHeapStats> memoryHeaps;
+    uint32_t streamingResources = 0;        // Evictable resources resident
+    VkDeviceSize streamingBytes = 0;
+    uint64_t evictions = 0;
+    VkDeviceSize evictedBytes = 0;
+
+    // -- HOST MEMORY --
+    std::vector<HostScopeStats> hostScopes;     // Driver host allocations by scope, empty if allocation callbacks are off
+
+    // -- UPLOADS --
+    VkDeviceSize uploadBytesLastFrame = 0;
+    VkDeviceSize uploadHighWater = 0;       // Most uploaded in one frame
+    uint64_t uploadOverflows = 0;           // Allocations that didn't fit in a frame's arena
+    uint64_t stagedUploads = 0;             // Through the staging manager
+    uint64_t stagingCopyCommands = 0;       // Copy commands the staged uploads were coalesced into
+    uint64_t stagingBatches = 0;
+    VkDeviceSize stagedBytes = 0;
+    uint64_t hostImageCopies = 0;           // Texture uploads written on the host (VK_EXT_host_image_copy)
+    uint64_t stagedImageCopies = 0;         // Texture uploads that fell back to staging
+
+    // -- GEOMETRY --
+    bool vertexPulling = false;             // Scene drawn through buffer device addresses (false = path unavailable or off)
+    uint64_t pulledDraws = 0;
+    VkDeviceSize geometryBytes = 0;         // Static vertex and index data uploaded
+
+    // -- CAPTURE --
+    uint64_t framesCaptured = 0;        // Written to disk
+    uint64_t captureFailures = 0;       // Not written, or dropped because too many were waiting to be encoded
+
+    // -- DYNAMIC RESOLUTION --
+    float resolutionScale = 1.0f;       // Scene resolution as a fraction of the output extent
+    double gpuFrameTimeMs = 0.0;        // Smoothed, 0 if timestamps aren't supported
+
+    // -- LATENCY --
+    bool presentWaitPacing = false;     // Latency limiter waits on presentation (false = on GPU completion)
+    double inputLatencyMs = 0.0;        // Input sample to presentation, smoothed
+    double pacingDelayMs = 0.0;
+
+    // -- VALIDATION --
+    uint64_t performanceWarningsTotal = 0;                      // Over the whole run
+    uint32_t performanceWarningsLastFrame = 0;
+    std::vector<PerformanceWarningStats> topPerformanceWarnings; // Most frequent first
+};
+
+// Breakdown of how well a physical device suits the renderer (higher is better)
+struct DeviceScore
+{
+    VkPhysicalDevice device = VK_NULL_HANDLE;
+    std::string name;
+    int typeScore = 0;          // Discrete > Integrated > Virtual > CPU
+    int memoryScore = 0;        // Size of largest device local heap
+    int queueScore = 0;         // Dedicated compute/transfer families, combined graphics and presentation
+    int featureScore = 0;       // Optional features that are supported
+    int limitScore = 0;         // Generous device limits
+    double benchmarkScore = 0;  // Fill rate in GB/s from the tie-break benchmark (if it was run)
+
+    int total() const
+    {
+        return typeScore + memoryScore + queueScore + featureScore + limitScore;
+    }
+};
+
+// Layouts read by shaders/geometry.vert through buffer device addresses (std430)
+struct PulledVertex
+{
+    float position[2];
+    uint32_t colour;        // RGBA8
+    uint32_t padding;
+};
+
+struct PulledInstance
+{
+    float offset[2];
+    float scale;
+    float rotation;         // Radians
+};
+
+// Everything a vertex pulling draw reads, so nothing is bound per draw but the push constants
+struct GeometryPushConstants
+{
+    VkDeviceAddress vertices;
+    VkDeviceAddress indices;
+    VkDeviceAddress instances;
+    float aspect;           // Height / width of the scene
+    float padding;
+};
+
+struct SwapchainImage
+{
+    VkImage image;
+    VkImageView imageView;
+    VkSemaphore renderFinished;     // Signalled when drawing to the image is done, waited on by its present
+                                    // (per image, as only re-acquiring the image shows the present has consumed it)
+};
+
+// Swapchain replaced by a recreation, kept until its presents are known to be finished with it
+struct RetiredSwapchain
+{
+    VkSwapchainKHR swapchain;
+    std::vector<SwapchainImage> images;
+    std::vector<VkFence> presentFences;     // Fences of the presents made to it (swapchain maintenance1 only)
+    uint64_t releaseFrame = 0;              // Without maintenance1: destroyed once frames up to this have completed (0 = not set yet)
+};
+
+// Host visible buffer a frame's output is copied into, read on the CPU the next time the frame context is reused
+struct ReadbackBuffer
+{
+    ResourcePool::Buffer storage;       // Persistently mapped, from the resource pool
+    bool pending;                       // Holds a copy that hasn't been read yet
+    uint64_t frameNumber;
+    VkExtent2D extent;
+    VkFormat format;
+};
+
+// Everything one frame in flight needs, so the CPU can record the next frame while the GPU works on this one
+struct FrameContext
+{
+    VkCommandPool commandPool;          // Transient pool, reset as a whole when the frame is reused
+    VkCommandBuffer commandBuffer;
+    VkFence inFlightFence;              // Signalled when the GPU has finished the frame
+    VkSemaphore imageAvailable;         // Signalled when the swapchain image can be drawn to
+    uint64_t frameNumber;               // Last frame recorded with this context
+    uint32_t timestampQuery;            // First of the two timestamp queries (start, end) this frame writes
+    bool timestampsWritten;             // Queries hold results from the last time this frame was used
+    ReadbackBuffer readback;
+    UploadArena uploads;                // Per-frame data written by the CPU, recycled when the fence signals
+};
+
+// Image rendered to instead of a swapchain image when there is no surface (headless)
+struct OffscreenImage
+{
+    VkImage image;
+    GpuAllocation allocation;
+    VkImageView imageView;
+};
+
+static uint32_t findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t allowedTypes, VkMemoryPropertyFlags properties)
+{
+    // Get properties of physical device memory
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        if ((allowedTypes & (1 << i))                                                       // Index of memory type must match corresponding bit in allowedTypes
+            && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)  // Desired property bit flags are part of memory type's property flags
+        {
+            // This memory type is valid, so return its index
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find a suitable memory type!");
+}
@@ -5,35 +5,619 @@ VulkanRenderer::VulkanRenderer()
 
 }
 
-int VulkanRenderer::init(GLFWwindow* newWindow)
+int VulkanRenderer::init(GLFWwindow* newWindow, const RendererConfig& config)
 {
-    mWindow = newWindow;
+    return init([newWindow]() { return newWindow; }, config);
+}
+
+int VulkanRenderer::init(const std::function<GLFWwindow*()>& createWindow, const RendererConfig& config)
+{
+    mConfig = config;
+
+    // Environment variable takes priority over config, so CI can collect traces without changing arguments
+    const char *environmentTracePath = getenv("LV_TRACE_FILE");
+    if (environmentTracePath != nullptr)
+    {
+        mConfig.tracePath = environmentTracePath;
+    }
+
+    // Present mode can be picked per deployment
+    const char *environmentPresentMode = getenv("LV_PRESENT_MODE");
+    if (environmentPresentMode != nullptr && !parsePresentPolicy(environmentPresentMode, mConfig.presentPolicy))
+    {
+        printf("Unknown LV_PRESENT_MODE \"%s\" (expected fifo, fifo-relaxed, mailbox or immediate)\n", environmentPresentMode);
+    }
+
+    // Validation tier can also be picked per run, without rebuilding
+    const char *environmentValidation = getenv("LV_VALIDATION");
+    if (environmentValidation != nullptr && !parseValidationLevel(environmentValidation, mConfig.validationLevel))
+    {
+        printf("Unknown LV_VALIDATION level \"%s\" (expected off, core, sync, best-practices or gpu)\n", environmentValidation);
+    }
+    mValidationEnabled = mConfig.validationLevel != ValidationLevel::Off;
+
+    // Driver host memory goes through our allocator for the whole life of the instance
+    mHostCallbacks = mConfig.hostAllocationCallbacks ? mHostAllocator.getCallbacks() : nullptr;
+
+    // Messages can arrive as soon as the instance is being created
+    if (mValidationEnabled)
+    {
+        mDebugLogger.start();
+    }
 
+    // Workers for parallel start up (and any later background work), leaving the main thread free for GLFW
+    size_t workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    mWorkers = std::make_unique<ThreadPool>(workerCount);
+
+    auto initStart = TraceRecorder::Clock::now();
     try
     {
-        createInstance();
-        createDebugCallback();
-        createSurface();
-        getPhysicalDevice();
-        createLogicalDevice();
+        // Each stage only waits for the stages whose Vulkan objects it needs, so independent work overlaps
+        // (e.g. the instance is created while the main thread creates the window)
+        // Every stage is timed, so regressions in cold-start time show up in the trace
+        TaskGraph startup;
+        auto window = startup.add("initWindow", [this, &createWindow]()
+        {
+            mWindow = createWindow ? createWindow() : nullptr;
+            updateFramebufferSize();
+        }, {}, true);
+        auto instance = startup.add("createInstance", [this]() { createInstance(); });
+        startup.add("createDebugCallback", [this]() { createDebugCallback(); }, { instance });
+        auto surface = startup.add("createSurface", [this]() { createSurface(); }, { instance, window });
+        auto physicalDevice = startup.add("getPhysicalDevice", [this]() { getPhysicalDevice(); }, { surface });
+        auto logicalDevice = startup.add("createLogicalDevice", [this]() { createLogicalDevice(); }, { physicalDevice });
+        auto offscreenImages = startup.add("createOffscreenImages", [this]() { createOffscreenImages(); }, { logicalDevice });
+        auto swapchain = startup.add("createSwapchain", [this]() { createSwapchain(); }, { logicalDevice });
+        auto frameContexts = startup.add("createFrameContexts", [this]() { createFrameContexts(); }, { logicalDevice });
+        startup.add("createGeometryPass", [this]() { createGeometryPass(); }, { offscreenImages, swapchain, frameContexts });
+
+        startup.run(mConfig.parallelStartup ? mWorkers.get() : nullptr, &mTrace);
     } catch (const std::runtime_error &e)
     {
         printf("ERROR: %s\n", e.what());
+
+        // Stages that did run are still worth seeing, especially the one that failed
+        mTrace.record("VulkanRenderer::init (failed)", "init", initStart, TraceRecorder::Clock::now());
+        writeTrace();
         return EXIT_FAILURE;
     }
+    auto initEnd = TraceRecorder::Clock::now();
+    mTrace.record("VulkanRenderer::init", "init", initStart, initEnd);
+
+    printf("Renderer initialised in %.2f ms\n", std::chrono::duration<double, std::milli>(initEnd - initStart).count());
+    writeTrace();
 
     return 0;
 }
 
+void VulkanRenderer::beginFrame()
+{
+    if (mConfig.limitLatency)
+    {
+        mLatencyLimiter.beginFrame(mFrameNumber);
+    }
+}
+
+bool VulkanRenderer::draw()
+{
+    // Nothing can be presented while the window is minimised, skip the frame rather than building a 0x0 swapchain
+    if (mWindow != nullptr)
+    {
+        updateFramebufferSize();
+        if (mFramebufferExtent.width == 0 || mFramebufferExtent.height == 0)
+            return false;
+    }
+
+    // -- GET NEXT FRAME --
+    // Wait for the GPU to finish with this frame context (the last time it was used, framesInFlight frames ago)
+    FrameContext &frame = mFrames[mFrameIndex];
+    mDispatch.vkWaitForFences(mMainDevice.logicalDevice, 1, &frame.inFlightFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+    // Frames finish in submission order, so everything retired before the frame just waited on can go
+    mDeletionQueue.collect(getFramesCompleted());
+
+    // GPU time of this frame context's last frame decides the scene resolution for this one
+    readFrameTimestamps(frame);
+
+    // Copy from this context's last frame has landed, hand it to a worker to encode
+    drainReadback(frame.readback);
+
+    // GPU has finished reading last time's uploads, so the whole arena is free again
+    frame.uploads.reset();
+
+    // Staging memory of finished transfer batches can be reused
+    mStaging.collect();
+
+    // Refresh heap budgets, evicting streaming resources no frame in flight uses if a heap is close to its budget
+    mResidency.update(getFramesCompleted());
+
+    // Pooled resources released by finished frames can be handed out again, long unused ones are destroyed
+    mResourcePool.update(getFramesCompleted());
+
+    // Pick the image to draw to, from the swapchain or from the offscreen images when there is no surface
+    bool presenting = mSwapchain != VK_NULL_HANDLE;
+    uint32_t imageIndex = 0;
+    VkImage targetImage;
+    if (presenting)
+    {
+        if (!acquireNextImage(frame, imageIndex))
+            return false;
+        targetImage = mSwapchainImages[imageIndex].image;
+    }
+    else
+    {
+        imageIndex = static_cast<uint32_t>(mFrameNumber % mOffscreenImages.size());
+        targetImage = mOffscreenImages[imageIndex].image;
+    }
+
+    // Only reset once work is definitely being submitted, otherwise the next wait on it would never return
+    mDispatch.vkResetFences(mMainDevice.logicalDevice, 1, &frame.inFlightFence);
+
+    // This frame will be submitted, so it answers the redraw request (one arriving while it's recorded gets another frame)
+    mRedrawRequested.store(false, std::memory_order_release);
+
+    // -- RECORD --
+    VkExtent2D outputExtent = presenting ? mSwapchainExtent : mOffscreenExtent;
+    updateSceneTarget(outputExtent, presenting ? mSwapchainImageFormat : mOffscreenFormat);
+
+    // Capture only 4 byte per pixel formats, which is all the swapchain and offscreen images use in practice
+    VkFormat outputFormat = presenting ? mSwapchainImageFormat : mOffscreenFormat;
+    bool captureFormatSupported = outputFormat == VK_FORMAT_R8G8B8A8_UNORM || outputFormat == VK_FORMAT_R8G8B8A8_SRGB
+                                  || outputFormat == VK_FORMAT_B8G8R8A8_UNORM || outputFormat == VK_FORMAT_B8G8R8A8_SRGB;
+    bool capture = !mConfig.capturePath.empty() && captureFormatSupported
+                   && (!presenting || (mSwapchainSupportsTransfer && mSwapchainSupportsReadback))
+                   && mFrameNumber % std::max(1u, mConfig.captureInterval) == 0;
+
+    ReadbackBuffer *readback = nullptr;
+    if (capture)
+    {
+        // Fence has been waited on, so the buffer is free to be replaced if the output has grown
+        VkDeviceSize readbackSize = static_cast<VkDeviceSize>(outputExtent.width) * outputExtent.height * 4;
+        if (frame.readback.storage.desc.size < readbackSize)
+        {
+            destroyReadbackBuffer(frame.readback);
+            createReadbackBuffer(frame.readback, readbackSize);
+        }
+
+        frame.readback.pending = true;
+        frame.readback.frameNumber = mFrameNumber;
+        frame.readback.extent = outputExtent;
+        frame.readback.format = outputFormat;
+        readback = &frame.readback;
+    }
+
+    // Submit everything uploaded since the last frame, so this frame can use it
+    mStaging.flush();
+
+    frame.frameNumber = mFrameNumber;
+    StagingManager::GraphicsWait stagingWait = recordCommands(frame, targetImage, presenting ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                                              outputExtent, readback);
+
+    // Anything written to the frame's upload arena has to reach the GPU before it runs
+    frame.uploads.flush();
+
+    // -- SUBMIT COMMAND BUFFER TO RENDER --
+    // Waits on the acquired image (binary) and on the transfer batch it uses (timeline), values only matter for the timeline
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<uint64_t> waitValues;
+    if (presenting)
+    {
+        waitSemaphores.push_back(frame.imageAvailable);
+        waitStages.push_back(VK_PIPELINE_STAGE_TRANSFER_BIT);
+        waitValues.push_back(0);
+    }
+    if (stagingWait.semaphore != VK_NULL_HANDLE)
+    {
+        waitSemaphores.push_back(stagingWait.semaphore);
+        waitStages.push_back(stagingWait.stage);
+        waitValues.push_back(stagingWait.value);
+    }
+
+    // Signals the acquired image's present (binary) and the graphics timeline staging batches wait on before overwriting
+    std::vector<VkSemaphore> signalSemaphores;
+    std::vector<uint64_t> signalValues;
+    if (presenting)
+    {
+        signalSemaphores.push_back(mSwapchainImages[imageIndex].renderFinished);
+        signalValues.push_back(0);
+    }
+    StagingManager::GraphicsSignal stagingSignal = mStaging.getGraphicsSignal(mFrameNumber + 1);
+    if (stagingSignal.semaphore != VK_NULL_HANDLE)
+    {
+        signalSemaphores.push_back(stagingSignal.semaphore);
+        signalValues.push_back(stagingSignal.value);
+    }
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = stagingWait.semaphore != VK_NULL_HANDLE || stagingSignal.semaphore != VK_NULL_HANDLE ? &timelineInfo : nullptr;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());    // Number of semaphores to wait on
+    submitInfo.pWaitSemaphores = waitSemaphores.data();                             // List of semaphores to wait on
+    submitInfo.pWaitDstStageMask = waitStages.data();                               // Stages to check semaphores at
+    submitInfo.commandBufferCount = 1;                              // Number of command buffers to submit
+    submitInfo.pCommandBuffers = &frame.commandBuffer;              // Command buffer to submit
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());   // Number of semaphores to signal
+    submitInfo.pSignalSemaphores = signalSemaphores.data();                             // Semaphores to signal when command buffer finishes
+
+    // Submit command buffer to queue, fence lets the CPU know when this frame context can be reused
+    VkResult result = mDispatch.vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, frame.inFlightFence);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit Command Buffer to Queue!");
+    }
+
+    // -- PRESENT RENDERED IMAGE TO SCREEN --
+    if (presenting)
+    {
+        // Tag the present so the latency limiter can wait for it to reach the screen
+        uint64_t presentId = mLatencyLimiter.getPresentId(mFrameNumber);
+        VkPresentIdKHR presentIdInfo = {};
+        presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+        presentIdInfo.swapchainCount = 1;
+        presentIdInfo.pPresentIds = &presentId;
+
+        // Fence signals once the present is finished with the swapchain, so a retired one knows when it can go
+        VkFence presentFence = mEnabledFeatures.swapchainMaintenance1 ? getPresentFence() : VK_NULL_HANDLE;
+        VkSwapchainPresentFenceInfoEXT presentFenceInfo = {};
+        presentFenceInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_FENCE_INFO_EXT;
+        presentFenceInfo.pNext = presentId != 0 ? &presentIdInfo : nullptr;
+        presentFenceInfo.swapchainCount = 1;
+        presentFenceInfo.pFences = &presentFence;
+
+        VkPresentInfoKHR presentInfo = {};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.pNext = presentFence != VK_NULL_HANDLE ? (const void*)&presentFenceInfo : presentFenceInfo.pNext;
+        presentInfo.waitSemaphoreCount = 1;                         // Number of semaphores to wait on
+        presentInfo.pWaitSemaphores = &mSwapchainImages[imageIndex].renderFinished;    // Semaphores to wait on
+        presentInfo.swapchainCount = 1;                             // Number of swapchains to present to
+        presentInfo.pSwapchains = &mSwapchain;                      // Swapchains to present images to
+        presentInfo.pImageIndices = &imageIndex;                    // Index of images in swapchains to present
+
+        result = mDispatch.vkQueuePresentKHR(mPresentationQueue, &presentInfo);
+        if (result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR)
+        {
+            // Image was still shown (or dropped), swapchain is replaced before the next acquire
+            mSwapchainOutOfDate = true;
+        }
+        else if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to present Image!");
+        }
+
+        // Fence is signalled even when the present is out of date, as its semaphore wait still happens
+        if (presentFence != VK_NULL_HANDLE)
+        {
+            mPresentFences.push_back(presentFence);
+        }
+    }
+    collectRetiredSwapchains(presenting && result == VK_SUCCESS);
+
+    // Move on to the next frame context
+    mLatencyLimiter.framePresented(mFrameNumber, presenting ? mSwapchain : VK_NULL_HANDLE, frame.inFlightFence);
+    mPerformanceWarnings.endFrame();
+    mFrameNumber++;
+    mFrameIndex = (mFrameIndex + 1) % static_cast<uint32_t>(mFrames.size());
+    return true;
+}
+
+void VulkanRenderer::notifyFramebufferResized()
+{
+    mSwapchainOutOfDate = true;
+    requestRedraw();
+}
+
+void VulkanRenderer::requestRedraw()
+{
+    mRedrawRequested.store(true, std::memory_order_release);
+
+    // Wake the main thread if it's blocked waiting for events (glfwPostEmptyEvent can be called from any thread)
+    if (mWindow != nullptr)
+    {
+        glfwPostEmptyEvent();
+    }
+}
+
+void VulkanRenderer::setAnimating(bool animating)
+{
+    mAnimating = animating;
+}
+
+bool VulkanRenderer::needsRedraw() const
+{
+    return mRedrawRequested.load(std::memory_order_acquire) || mAnimating.load();
+}
+
+bool VulkanRenderer::acquireNextImage(FrameContext &frame, uint32_t &imageIndex)
+{
+    if (mSwapchainOutOfDate)
+    {
+        recreateSwapchain();
+    }
+
+    // Try once on the current swapchain, and once more on a new one if the surface changed underneath it
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        VkResult result = mDispatch.vkAcquireNextImageKHR(mMainDevice.logicalDevice, mSwapchain, std::numeric_limits<uint64_t>::max(),
+                                                          frame.imageAvailable, VK_NULL_HANDLE, &imageIndex);
+        if (result == VK_SUCCESS)
+            return true;
+
+        // Image is usable (and the semaphore will be signalled), so draw this frame and replace the swapchain for the next one
+        if (result == VK_SUBOPTIMAL_KHR)
+        {
+            mSwapchainOutOfDate = true;
+            return true;
+        }
+
+        if (result != VK_ERROR_OUT_OF_DATE_KHR)
+        {
+            throw std::runtime_error("Failed to acquire a Swapchain Image!");
+        }
+
+        recreateSwapchain();
+    }
+
+    // Surface is still changing (e.g. mid-resize), try again next frame
+    return false;
+}
+
+void VulkanRenderer::writeTrace()
+{
+    if (mConfig.tracePath.empty())
+        return;
+
+    if (!mTrace.writeChromeTrace(mConfig.tracePath))
+    {
+        printf("Failed to write trace to %s\n", mConfig.tracePath.c_str());
+    }
+}
+
+TraceRecorder& VulkanRenderer::getTrace()
+{
+    return mTrace;
+}
+
+StagingManager& VulkanRenderer::getStagingManager()
+{
+    return mStaging;
+}
+
+ResidencyManager& VulkanRenderer::getResidencyManager()
+{
+    return mResidency;
+}
+
+uint64_t VulkanRenderer::getFrameNumber() const
+{
+    return mFrameNumber;
+}
+
+TextureUploader& VulkanRenderer::getTextureUploader()
+{
+    return mTextureUploader;
+}
+
+const DeviceFeatures& VulkanRenderer::getEnabledFeatures() const
+{
+    return mEnabledFeatures;
+}
+
+RendererStats VulkanRenderer::getStats() const
+{
+    RendererStats stats;
+
+    stats.framesRendered = mFrameNumber;
+    stats.framesInFlight = static_cast<uint32_t>(mFrames.size());
+    stats.swapchainRecreations = mSwapchainGeneration;
+
+    GpuAllocator::Stats memory = mAllocator.getStats();
+    stats.deviceMemoryAllocations = memory.deviceMemoryCount;
+    stats.memoryBlocks = memory.blockCount;
+    stats.dedicatedAllocations = memory.dedicatedCount;
+    stats.memoryReserved = memory.bytesReserved;
+    stats.memoryUsed = memory.bytesUsed;
+
+    stats.memoryBudgetQueried = mEnabledFeatures.memoryBudget;
+    for (const auto &heap : mResidency.getHeapBudgets())
+    {
+        stats.memoryHeaps.push_back({ heap.size, heap.budget, heap.usage, heap.deviceLocal });
+    }
+    ResidencyManager::Stats residency = mResidency.getStats();
+    stats.streamingResources = residency.resources;
+    stats.streamingBytes = residency.residentBytes;
+    stats.evictions = residency.evictions;
+    stats.evictedBytes = residency.evictedBytes;
+
+    for (const auto &frame : mFrames)
+    {
+        UploadArena::Stats uploads = frame.uploads.getStats();
+        stats.uploadHighWater = std::max(stats.uploadHighWater, uploads.highWater);
+        stats.uploadOverflows += uploads.overflows;
+    }
+    if (!mFrames.empty() && mFrameNumber > 0)
+    {
+        // Context of the most recently submitted frame, whose arena use was recorded when it was flushed for submit
+        const FrameContext &lastSubmitted = mFrames[(mFrameIndex + mFrames.size() - 1) % mFrames.size()];
+        stats.uploadBytesLastFrame = lastSubmitted.uploads.getStats().usedLastFrame;
+    }
+
+    StagingManager::Stats staging = mStaging.getStats();
+    stats.stagedUploads = staging.uploads;
+    stats.stagingCopyCommands = staging.copyCommands;
+    stats.stagingBatches = staging.batches;
+    stats.stagedBytes = staging.bytesUploaded;
+    TextureUploader::Stats textures = mTextureUploader.getStats();
+    stats.hostImageCopies = textures.hostCopies;
+    stats.stagedImageCopies = textures.stagedCopies;
+
+    // Only counts as on while the scene path that draws it is in use (a recreated swapchain may have changed format)
+    bool canWriteOutput = mSwapchain == VK_NULL_HANDLE || mSwapchainSupportsTransfer;
+    stats.vertexPulling = mGeometryPipeline != VK_NULL_HANDLE && mGeometryPipelineFormat == mSceneFormat && mSceneBlitSupported && canWriteOutput;
+    stats.pulledDraws = mPulledDraws;
+    stats.geometryBytes = mGeometry.getStats().used;
+
+    if (mHostCallbacks != nullptr)
+    {
+        for (uint32_t scope = 0; scope < HostAllocator::ScopeCount; scope++)
+        {
+            HostAllocator::ScopeStats host = mHostAllocator.getScopeStats(static_cast<VkSystemAllocationScope>(scope));
+            stats.hostScopes.push_back({ HostAllocator::getScopeName(static_cast<VkSystemAllocationScope>(scope)),
+                                         host.allocations, host.liveAllocations, host.bytes, host.highWater, host.internalBytes });
+        }
+    }
+
+    stats.pendingDeletions = static_cast<uint32_t>(mDeletionQueue.getPendingCount());
+    ResourcePool::Stats pool = mResourcePool.getStats();
+    stats.pooledResourcesCreated = pool.created;
+    stats.pooledResourcesReused = pool.reused;
+    stats.pooledResourcesIdle = pool.idleImages + pool.idleBuffers;
+
+    stats.framesCaptured = mFramesCaptured.load();
+    stats.captureFailures = mCaptureFailures.load();
+
+    stats.resolutionScale = mSceneBlitSupported ? mResolution.getScale() : 1.0f;
+    stats.gpuFrameTimeMs = mResolution.getGpuTimeMs();
+
+    LatencyLimiter::Stats latency = mLatencyLimiter.getStats();
+    stats.presentWaitPacing = latency.usingPresentWait;
+    stats.inputLatencyMs = latency.latencyMs;
+    stats.pacingDelayMs = latency.delayMs;
+
+    stats.performanceWarningsTotal = mPerformanceWarnings.getRunTotal();
+    stats.performanceWarningsLastFrame = mPerformanceWarnings.getLastFrameTotal();
+    for (const auto &count : mPerformanceWarnings.getTop(mConfig.performanceWarningReportCount))
+    {
+        stats.topPerformanceWarnings.push_back({ count.messageId, count.name, count.runTotal, count.lastFrameTotal });
+    }
+
+    return stats;
+}
+
 void VulkanRenderer::cleanup()
 {
-    vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
-    vkDestroyDevice(mMainDevice.logicalDevice, nullptr);
-    if (validationEnabled)
+    auto cleanupStart = TraceRecorder::Clock::now();
+
+    // Wait until no actions being run on device before destroying
+    if (mMainDevice.logicalDevice != VK_NULL_HANDLE)
+    {
+        mDispatch.vkDeviceWaitIdle(mMainDevice.logicalDevice);
+    }
+
+    for (auto &frame : mFrames)
+    {
+        // Last few frames' captures are still waiting to be read
+        drainReadback(frame.readback);
+        destroyReadbackBuffer(frame.readback);
+        frame.uploads.destroy();
+
+        mDispatch.vkDestroySemaphore(mMainDevice.logicalDevice, frame.imageAvailable, mDispatch.allocator);
+        mDispatch.vkDestroyFence(mMainDevice.logicalDevice, frame.inFlightFence, mDispatch.allocator);
+        mDispatch.vkDestroyCommandPool(mMainDevice.logicalDevice, frame.commandPool, mDispatch.allocator);
+    }
+    mFrames.clear();
+
+    for (auto &offscreenImage : mOffscreenImages)
+    {
+        destroyColourImage(offscreenImage);
+    }
+    mOffscreenImages.clear();
+
+    mResourcePool.release(mSceneTarget, 0);
+    if (mTimestampQueryPool != VK_NULL_HANDLE)
+    {
+        mDispatch.vkDestroyQueryPool(mMainDevice.logicalDevice, mTimestampQueryPool, mDispatch.allocator);
+    }
+
+    // Each handle separately, creation can fail part way through
+    if (mGeometryPipeline != VK_NULL_HANDLE)
+    {
+        mDispatch.vkDestroyPipeline(mMainDevice.logicalDevice, mGeometryPipeline, mDispatch.allocator);
+    }
+    if (mGeometryPipelineLayout != VK_NULL_HANDLE)
+    {
+        mDispatch.vkDestroyPipelineLayout(mMainDevice.logicalDevice, mGeometryPipelineLayout, mDispatch.allocator);
+    }
+    if (mGeometryFragmentShader != VK_NULL_HANDLE)
+    {
+        mDispatch.vkDestroyShaderModule(mMainDevice.logicalDevice, mGeometryFragmentShader, mDispatch.allocator);
+    }
+    if (mGeometryVertexShader != VK_NULL_HANDLE)
+    {
+        mDispatch.vkDestroyShaderModule(mMainDevice.logicalDevice, mGeometryVertexShader, mDispatch.allocator);
+    }
+    mGeometry.destroy();
+
+    // Device is idle, everything still waiting on a frame can go
+    mDeletionQueue.flush();
+
+    // Presents aren't covered by the device wait, their fences are
+    std::vector<VkFence> presentFences = mPresentFences;
+    for (const auto &retired : mRetiredSwapchains)
+    {
+        presentFences.insert(presentFences.end(), retired.presentFences.begin(), retired.presentFences.end());
+    }
+    if (!presentFences.empty())
     {
-        DestroyDebugUtilsMessengerEXT(mInstance, callback, nullptr);
+        mDispatch.vkWaitForFences(mMainDevice.logicalDevice, static_cast<uint32_t>(presentFences.size()), presentFences.data(), VK_TRUE, std::numeric_limits<uint64_t>::max());
     }
-    vkDestroyInstance(mInstance, nullptr);
+    for (auto &retired : mRetiredSwapchains)
+    {
+        destroyRetiredSwapchain(retired);
+    }
+    mRetiredSwapchains.clear();
+    mFreePresentFences.insert(mFreePresentFences.end(), mPresentFences.begin(), mPresentFences.end());
+    mPresentFences.clear();
+    for (VkFence fence : mFreePresentFences)
+    {
+        mDispatch.vkDestroyFence(mMainDevice.logicalDevice, fence, mDispatch.allocator);
+    }
+    mFreePresentFences.clear();
+
+    for (auto &image : mSwapchainImages)
+    {
+        mDispatch.vkDestroySemaphore(mMainDevice.logicalDevice, image.renderFinished, mDispatch.allocator);
+        mDispatch.vkDestroyImageView(mMainDevice.logicalDevice, image.imageView, mDispatch.allocator);
+    }
+    mSwapchainImages.clear();
+    if (mSwapchain != VK_NULL_HANDLE)
+    {
+        mDispatch.vkDestroySwapchainKHR(mMainDevice.logicalDevice, mSwapchain, mDispatch.allocator);
+    }
+
+    if (mSurface != VK_NULL_HANDLE)
+    {
+        vkDestroySurfaceKHR(mInstance, mSurface, mHostCallbacks);
+    }
+    if (mMainDevice.logicalDevice != VK_NULL_HANDLE)
+    {
+        mStaging.destroy();
+        mResourcePool.destroy();
+        mAllocator.destroy();
+    }
+    mDispatch.vkDestroyDevice(mMainDevice.logicalDevice, mDispatch.allocator);
+    if (mValidationEnabled)
+    {
+        mInstanceDispatch.vkDestroyDebugUtilsMessengerEXT(mInstance, callback, mHostCallbacks);
+    }
+    vkDestroyInstance(mInstance, mHostCallbacks);
+
+    // Print whatever validation output is still queued, and the repeat counts
+    mDebugLogger.stop();
+    mPerformanceWarnings.printReport(mConfig.performanceWarningReportCount);
+
+    mWorkers.reset();
+
+    // Rewrite the trace so it includes everything brought up after init, and the shutdown itself
+    mTrace.record("VulkanRenderer::cleanup", "shutdown", cleanupStart, TraceRecorder::Clock::now());
+    writeTrace();
 }
 
 VulkanRenderer::~VulkanRenderer()
@@ -43,7 +627,7 @@ VulkanRenderer::~VulkanRenderer()
 
 void VulkanRenderer::createInstance()
 {
-    if (validationEnabled && !checkValidationLayerSupport())
+    if (mValidationEnabled && !checkValidationLayerSupport())
     {
         throw std::runtime_error("Required Validation Layers not supported!");
     }
@@ -56,7 +640,17 @@ void VulkanRenderer::createInstance()
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0); // Custom version of the application
     appInfo.pEngineName = "No Engine"; // Custom engine name
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0); // Custom engine version
-    appInfo.apiVersion = VK_API_VERSION_1_0; // The Vulkan Version
+
+    // Use the newest Vulkan version up to 1.3 the loader supports (1.0 loaders don't have vkEnumerateInstanceVersion)
+    mInstanceApiVersion = VK_API_VERSION_1_0;
+    auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+    if (enumerateInstanceVersion != nullptr)
+    {
+        uint32_t loaderVersion = VK_API_VERSION_1_0;
+        enumerateInstanceVersion(&loaderVersion);
+        mInstanceApiVersion = std::min(VK_MAKE_API_VERSION(0, VK_API_VERSION_MAJOR(loaderVersion), VK_API_VERSION_MINOR(loaderVersion), 0), VK_API_VERSION_1_3);
+    }
+    appInfo.apiVersion = mInstanceApiVersion; // The Vulkan Version
 
 
     // Creation information for a VkInstance (Vulkan Instance)
@@ -67,42 +661,110 @@ void VulkanRenderer::createInstance()
     // Create list to hold instance extensions
     std::vector<const char*> instanceExtensions = std::vector<const char*>();
 
-    // Set up extensions Instance will use
-    uint32_t glfwExtensionCount = 0; // GLFW may require multiple extensions
-    const char** glfwExtensions; // Extensions passed as array of cstrings, so need pointer (the array) to pointer (the cstring)
+    if (!mConfig.headless)
+    {
+        // Set up extensions Instance will use
+        uint32_t glfwExtensionCount = 0; // GLFW may require multiple extensions
+        const char** glfwExtensions; // Extensions passed as array of cstrings, so need pointer (the array) to pointer (the cstring)
+
+        // Get GLFW extensions
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-    // Get GLFW extensions
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        // Add GLFW extensions to list of extensions
+        for (size_t i = 0; i < glfwExtensionCount; i++)
+        {
+            instanceExtensions.push_back(glfwExtensions[i]);
+        }
+    }
+    else if (mConfig.useHeadlessSurface)
+    {
+        // Headless surface is optional, so only use it if the instance supports it (otherwise render with no surface at all)
+        std::vector<const char*> headlessExtensions = { VK_KHR_SURFACE_EXTENSION_NAME, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME };
+        mHeadlessSurfaceSupported = checkInstanceExtensionsSupport(&headlessExtensions);
+        if (mHeadlessSurfaceSupported)
+        {
+            instanceExtensions.insert(instanceExtensions.end(), headlessExtensions.begin(), headlessExtensions.end());
+        }
+        else
+        {
+            printf("VK_EXT_headless_surface not supported, rendering without a surface\n");
+        }
+    }
 
-    // Add GLFW extensions to list of extensions
-    for (size_t i = 0; i < glfwExtensionCount; i++)
+    // Present fences (swapchain maintenance1) are a device extension, but need surface maintenance1 on the instance
+    mSurfaceMaintenanceSupported = false;
+    if ((!mConfig.headless || mHeadlessSurfaceSupported) && mInstanceApiVersion >= VK_API_VERSION_1_1)
     {
-        instanceExtensions.push_back(glfwExtensions[i]);
+        std::vector<const char*> surfaceMaintenanceExtensions = { VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME, VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME };
+        mSurfaceMaintenanceSupported = checkInstanceExtensionsSupport(&surfaceMaintenanceExtensions);
+        if (mSurfaceMaintenanceSupported)
+        {
+            instanceExtensions.insert(instanceExtensions.end(), surfaceMaintenanceExtensions.begin(), surfaceMaintenanceExtensions.end());
+        }
     }
 
     // If validation enabled, add extension to report validation debug info
-    if (validationEnabled)
+    if (mValidationEnabled)
     {
         instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
 
+    // Tiers above core are switched on through VK_EXT_validation_features, which the validation layer provides
+    std::vector<VkValidationFeatureEnableEXT> validationFeatures;
+    switch (mConfig.validationLevel)
+    {
+    case ValidationLevel::Synchronization:
+        validationFeatures.push_back(VK_VALIDATION_FEATURE_ENABLE_SYNCHRONIZATION_VALIDATION_EXT);
+        break;
+    case ValidationLevel::BestPractices:
+        validationFeatures.push_back(VK_VALIDATION_FEATURE_ENABLE_BEST_PRACTICES_EXT);
+        break;
+    case ValidationLevel::GpuAssisted:
+        validationFeatures.push_back(VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_EXT);
+        validationFeatures.push_back(VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_RESERVE_BINDING_SLOT_EXT);
+        break;
+    default:
+        break;
+    }
+
+    if (!validationFeatures.empty() && !checkValidationFeaturesSupport())
+    {
+        printf("VK_EXT_validation_features not supported, using core validation only\n");
+        validationFeatures.clear();
+    }
+
     // Check Instance Extensions supported...
     if (!checkInstanceExtensionsSupport(&instanceExtensions))
     {
         throw std::runtime_error("VkInstance does not support required extensions!");
     }
 
+    // Added after the check, as only the validation layer lists it (checkValidationFeaturesSupport has already looked there)
+    if (!validationFeatures.empty())
+    {
+        instanceExtensions.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+    }
+
     createInfo.enabledExtensionCount = static_cast<uint32_t>(instanceExtensions.size());
     createInfo.ppEnabledExtensionNames = instanceExtensions.data();
 
     VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo = {};
-    if (validationEnabled)
+    VkValidationFeaturesEXT validationFeaturesInfo = {};
+    if (mValidationEnabled)
     {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
         createInfo.ppEnabledLayerNames = validationLayers.data();
 
         populateDebugMessengerCreateInfo(debugCreateInfo);
         createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
+
+        if (!validationFeatures.empty())
+        {
+            validationFeaturesInfo.sType = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT;
+            validationFeaturesInfo.enabledValidationFeatureCount = static_cast<uint32_t>(validationFeatures.size());
+            validationFeaturesInfo.pEnabledValidationFeatures = validationFeatures.data();
+            debugCreateInfo.pNext = &validationFeaturesInfo;
+        }
     }
     else
     {
@@ -113,34 +775,42 @@ void VulkanRenderer::createInstance()
     }
 
     // Create instance
-    VkResult result = vkCreateInstance(&createInfo, nullptr, &mInstance);
+    VkResult result = vkCreateInstance(&createInfo, mHostCallbacks, &mInstance);
 
     if (result != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create a Vulkan Instance!");
     }
+
+    // Look up extension functions once, rather than every time they are called
+    mInstanceDispatch.load(mInstance);
 }
 
 void VulkanRenderer::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo)
 {
     createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-    createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT; // Which validation reports should initiate callback
+    createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT  // Which validation reports should initiate callback
+                                 | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;                                                 // (info only for counting performance messages)
     createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT; // Which message types to receive
     createInfo.pfnUserCallback = debugCallback;
-    createInfo.pUserData = nullptr;
+    createInfo.pUserData = &mDebugCallbackContext;         // Messages are queued to the logger thread rather than printed here
 }
 
 void VulkanRenderer::createDebugCallback()
 {
     // Only create callback if validation enabled
-    if (!validationEnabled)
+    if (!mValidationEnabled)
         return;
 
     VkDebugUtilsMessengerCreateInfoEXT createInfo = {};
     populateDebugMessengerCreateInfo(createInfo);
 
-    // Create debug callback with custom create function
-    VkResult result = CreateDebugUtilsMessengerEXT(mInstance, &createInfo, nullptr, &callback);
+    // Create debug callback with extension function (nullptr if extension not present)
+    if (mInstanceDispatch.vkCreateDebugUtilsMessengerEXT == nullptr)
+    {
+        throw std::runtime_error("Failed to create Debug Callback, VK_EXT_debug_utils not present!");
+    }
+    VkResult result = mInstanceDispatch.vkCreateDebugUtilsMessengerEXT(mInstance, &createInfo, mHostCallbacks, &callback);
     if (result != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create Debug Callback!");
@@ -152,21 +822,56 @@ void VulkanRenderer::createLogicalDevice()
     // Get the queue family indices for the chosen Physical Device
     QueueFamilyIndices indices = getQueueFamilies(mMainDevice.physicalDevice);
 
-    // Vector for queue creation information, and set for family indices
-    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<int> queueFamilyIndices = {indices.graphicsFamily, indices.presentationFamily};
+    // Number of queues available in each family
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(mMainDevice.physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(mMainDevice.physicalDevice, &queueFamilyCount, queueFamilyList.data());
 
-    // Queues the logical device needs to create and info to do so
-    for (int queueFamilyIndex : queueFamilyIndices)
+    // Priorities of the queues to create from each family, in queue index order
+    std::map<int, std::vector<float>> familyQueuePriorities;
+
+    // Give a role its own queue in the family if one is left, otherwise share the family's last queue
+    // A shared queue is the same VkQueue for several roles (e.g. transfer on graphics), and queue access must be externally
+    // synchronised. That's only safe because every submit and present (frame, staging flush, swapchain retirement) happens on
+    // the render thread, anything that submits from another thread must add a lock around the queue first
+    auto requestQueue = [&](int family, float priority) -> uint32_t
     {
-        VkDeviceQueueCreateInfo queueCreateInfo = {};
-        queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfo.queueFamilyIndex = queueFamilyIndex;                // The index of the family to create a queue from
-        queueCreateInfo.queueCount = 1;                                     // Number of queues to create
-        float priority = 1.0f;
-        queueCreateInfo.pQueuePriorities = &priority;                       // Vulkan needs to know how to handle multiple queues, so decide priority (1 = highest priority)
+        std::vector<float> &priorities = familyQueuePriorities[family];
+        if (priorities.size() < queueFamilyList[family].queueCount)
+        {
+            priorities.push_back(priority);
+        }
+        else
+        {
+            priorities.back() = std::max(priorities.back(), priority);
+        }
+        return static_cast<uint32_t>(priorities.size() - 1);
+    };
 
-        queueCreateInfos.push_back(queueCreateInfo);
+    uint32_t graphicsQueueIndex = requestQueue(indices.graphicsFamily, mConfig.graphicsQueuePriority);
+    uint32_t computeQueueIndex = indices.computeFamily >= 0 ? requestQueue(indices.computeFamily, mConfig.computeQueuePriority) : 0;
+    uint32_t transferQueueIndex = requestQueue(indices.transferFamily, mConfig.transferQueuePriority);
+
+    // Present from the graphics queue when the family is shared
+    bool hasPresentation = mSurface != VK_NULL_HANDLE;
+    uint32_t presentationQueueIndex = graphicsQueueIndex;
+    if (hasPresentation && indices.presentationFamily != indices.graphicsFamily)
+    {
+        presentationQueueIndex = requestQueue(indices.presentationFamily, mConfig.graphicsQueuePriority);
+    }
+
+    // Queues the logical device needs to create and info to do so
+    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+    for (const auto &familyQueues : familyQueuePriorities)
+    {
+        VkDeviceQueueCreateInfo queueCreateInfo = {};
+        queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueCreateInfo.queueFamilyIndex = familyQueues.first;                                  // The index of the family to create a queue from
+        queueCreateInfo.queueCount = static_cast<uint32_t>(familyQueues.second.size());         // Number of queues to create
+        queueCreateInfo.pQueuePriorities = familyQueues.second.data();                          // Vulkan needs to know how to handle multiple queues, so decide priority (1 = highest priority)
+
+        queueCreateInfos.push_back(queueCreateInfo);
     }
 
     // Information to create logical device (sometimes called "device")
@@ -174,32 +879,97 @@ void VulkanRenderer::createLogicalDevice()
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());     // Number of Queue Create Infos
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();                               // List of queue create infos so device can create requires queues
-    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());    // Number of enabled logical device extensions
-    deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();                         // List of enabled logical device extensions
+    mEnabledDeviceExtensions = getRequiredDeviceExtensions();
+    for (const char *extension : getOptionalDeviceExtensions())
+    {
+        mEnabledDeviceExtensions.push_back(extension);
+    }
+    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(mEnabledDeviceExtensions.size());  // Number of enabled logical device extensions
+    deviceCreateInfo.ppEnabledExtensionNames = mEnabledDeviceExtensions.data();                       // List of enabled logical device extensions
 
     // Physical Device Features the Logical Device will be using
-    VkPhysicalDeviceFeatures deviceFeatures = {};
+    FeatureChain enabledFeatures;
+    negotiateDeviceFeatures(enabledFeatures);
 
-    deviceCreateInfo.pEnabledFeatures = &deviceFeatures;        // Physical Device features Logical Device will use
+    if (mEnabledFeatures.apiVersion >= VK_API_VERSION_1_1)
+    {
+        deviceCreateInfo.pNext = &enabledFeatures.root();       // Whole feature chain, so pEnabledFeatures must stay null
+    }
+    else
+    {
+        deviceCreateInfo.pEnabledFeatures = &enabledFeatures.root().features;     // Physical Device features Logical Device will use
+    }
 
     // Create the logical device for the given physical device
-    VkResult result = vkCreateDevice(mMainDevice.physicalDevice, &deviceCreateInfo, nullptr, &mMainDevice.logicalDevice);
+    VkResult result = vkCreateDevice(mMainDevice.physicalDevice, &deviceCreateInfo, mHostCallbacks, &mMainDevice.logicalDevice);
     if (result != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create a Logical Device!");
     }
 
+    // Load device functions directly from the driver, so every call after this skips the loader
+    mDispatch.load(mMainDevice.logicalDevice);
+    mDispatch.allocator = mHostCallbacks;
+    mAllocator.init(&mDispatch, mMainDevice.physicalDevice, mMainDevice.logicalDevice, mEnabledFeatures.apiVersion,
+                    mEnabledFeatures.bufferDeviceAddress);
+    mResidency.init(mMainDevice.physicalDevice, &mAllocator, mEnabledFeatures.memoryBudget,
+                    mConfig.memoryBudgetThreshold, mConfig.memoryBudgetTarget);
+    mResourcePool.init(&mAllocator, &mDispatch, mMainDevice.logicalDevice, mConfig.poolMaxIdleFrames);
+
     // Queues are created at the same time as the device...
     // So we want handle to queues
-    // From given logicial device, of given Queue Family, of given Queue Index (0 since only one queue), place reference in given VkQueue
-    vkGetDeviceQueue(mMainDevice.logicalDevice, indices.graphicsFamily, 0, &mGraphicsQueue);
-    vkGetDeviceQueue(mMainDevice.logicalDevice, indices.presentationFamily, 0, &mPresentationQueue);
+    // From given logicial device, of given Queue Family, of given Queue Index, place reference in given VkQueue
+    mDispatch.vkGetDeviceQueue(mMainDevice.logicalDevice, indices.graphicsFamily, graphicsQueueIndex, &mGraphicsQueue);
+    mDispatch.vkGetDeviceQueue(mMainDevice.logicalDevice, indices.transferFamily, transferQueueIndex, &mTransferQueue);
+    if (indices.computeFamily >= 0)
+    {
+        mDispatch.vkGetDeviceQueue(mMainDevice.logicalDevice, indices.computeFamily, computeQueueIndex, &mComputeQueue);
+    }
+    else
+    {
+        mComputeQueue = VK_NULL_HANDLE;
+    }
+
+    if (hasPresentation)
+    {
+        mDispatch.vkGetDeviceQueue(mMainDevice.logicalDevice, indices.presentationFamily, presentationQueueIndex, &mPresentationQueue);
+    }
+    else
+    {
+        // Nothing is presented without a surface
+        mPresentationQueue = VK_NULL_HANDLE;
+    }
+
+    mQueueFamilyIndices = indices;
+
+    printf("Queues: graphics family %d, compute family %d%s, transfer family %d%s\n",
+           indices.graphicsFamily,
+           indices.computeFamily, indices.hasDedicatedCompute() ? " (dedicated)" : "",
+           indices.transferFamily, indices.hasDedicatedTransfer() ? " (dedicated)" : "");
 }
 
 void VulkanRenderer::createSurface()
 {
+    if (mConfig.headless)
+    {
+        // Without the headless surface extension there is no surface at all, and frames go to offscreen images
+        if (!mHeadlessSurfaceSupported)
+            return;
+
+        VkHeadlessSurfaceCreateInfoEXT headlessCreateInfo = {};
+        headlessCreateInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+
+        // Extension function, so comes from the instance dispatch table
+        if (mInstanceDispatch.vkCreateHeadlessSurfaceEXT == nullptr
+            || mInstanceDispatch.vkCreateHeadlessSurfaceEXT(mInstance, &headlessCreateInfo, mHostCallbacks, &mSurface) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create a headless surface!");
+        }
+        return;
+    }
+
     // Create Surface (creates a surface create info struct, runs the create surface function, returns result)
-    VkResult result = glfwCreateWindowSurface(mInstance, mWindow, nullptr, &mSurface);
+    VkResult result = glfwCreateWindowSurface(mInstance, mWindow, mHostCallbacks, &mSurface);
 
     if (result != VK_SUCCESS)
     {
@@ -207,6 +977,750 @@ void VulkanRenderer::createSurface()
     }
 }
 
+void VulkanRenderer::createOffscreenImages()
+{
+    // Only needed when there is no surface to get swapchain images from
+    if (mSurface != VK_NULL_HANDLE)
+        return;
+
+    mOffscreenFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    mOffscreenExtent = { mConfig.offscreenWidth, mConfig.offscreenHeight };
+
+    for (uint32_t i = 0; i < mConfig.offscreenImageCount; i++)
+    {
+        // Image rendered to in place of a swapchain image, and copied out for readback
+        mOffscreenImages.push_back(createColourImage(mOffscreenExtent, mOffscreenFormat,
+                                                     VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+    }
+}
+
+void VulkanRenderer::createFrameContexts()
+{
+    uint32_t framesInFlight = std::max(1u, std::min(mConfig.framesInFlight, 4u));
+
+    // Semaphore creation information
+    VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+    semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    // Fence creation information
+    VkFenceCreateInfo fenceCreateInfo = {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;              // Start signalled, so the first wait on each frame returns immediately
+
+    // Command pool is reset as a whole each frame, so its buffers are short lived (transient)
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = mQueueFamilyIndices.graphicsFamily;   // Queue Family type that buffers from this command pool will use
+
+    // Timestamps measure each frame's GPU time, for dynamic resolution
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(mMainDevice.physicalDevice, &deviceProperties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(mMainDevice.physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(mMainDevice.physicalDevice, &queueFamilyCount, queueFamilyList.data());
+    uint32_t timestampValidBits = queueFamilyList[mQueueFamilyIndices.graphicsFamily].timestampValidBits;
+
+    if (timestampValidBits > 0 && deviceProperties.limits.timestampPeriod > 0.0f)
+    {
+        VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+        queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolCreateInfo.queryCount = framesInFlight * 2;              // Start and end of each frame
+
+        if (mDispatch.vkCreateQueryPool(mMainDevice.logicalDevice, &queryPoolCreateInfo, mDispatch.allocator, &mTimestampQueryPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create a Query Pool!");
+        }
+
+        mTimestampPeriod = deviceProperties.limits.timestampPeriod;
+        mTimestampMask = timestampValidBits >= 64 ? std::numeric_limits<uint64_t>::max() : (1ull << timestampValidBits) - 1;
+    }
+
+    // Fixed at the largest scale when dynamic resolution is off (or can't be measured)
+    bool scaleResolution = mConfig.dynamicResolution && mTimestampQueryPool != VK_NULL_HANDLE;
+    mResolution.init(scaleResolution ? mConfig.minResolutionScale : mConfig.maxResolutionScale, mConfig.maxResolutionScale, mConfig.gpuFrameBudgetMs);
+
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+        FrameContext frame = {};
+        frame.timestampQuery = i * 2;
+
+        if (mDispatch.vkCreateCommandPool(mMainDevice.logicalDevice, &poolInfo, mDispatch.allocator, &frame.commandPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create a Command Pool!");
+        }
+
+        VkCommandBufferAllocateInfo cbAllocInfo = {};
+        cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cbAllocInfo.commandPool = frame.commandPool;
+        cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;            // Submitted directly to queue, can't be called by other buffers
+        cbAllocInfo.commandBufferCount = 1;
+
+        if (mDispatch.vkAllocateCommandBuffers(mMainDevice.logicalDevice, &cbAllocInfo, &frame.commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate Command Buffers!");
+        }
+
+        if (mDispatch.vkCreateSemaphore(mMainDevice.logicalDevice, &semaphoreCreateInfo, mDispatch.allocator, &frame.imageAvailable) != VK_SUCCESS
+            || mDispatch.vkCreateFence(mMainDevice.logicalDevice, &fenceCreateInfo, mDispatch.allocator, &frame.inFlightFence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create a Semaphore and/or Fence!");
+        }
+
+        // Bound as dynamic uniform/storage buffers, vertex/index buffers, read through device addresses, or copied from
+        VkDeviceSize uploadAlignment = std::max({ deviceProperties.limits.minUniformBufferOffsetAlignment,
+                                                  deviceProperties.limits.minStorageBufferOffsetAlignment, VkDeviceSize(16) });
+        VkBufferUsageFlags uploadUsage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+                                         | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        if (mEnabledFeatures.bufferDeviceAddress)
+        {
+            uploadUsage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+        }
+        frame.uploads.init(&mAllocator, &mDispatch, mMainDevice.logicalDevice, mConfig.uploadArenaSize, uploadAlignment, uploadUsage);
+
+        mFrames.push_back(frame);
+    }
+
+    // Present wait needs both extensions, otherwise pacing falls back to waiting on frame fences
+    // Frames queued can't exceed the frames in flight, as older fences have been reused
+    bool usePresentWait = mEnabledFeatures.presentId && mEnabledFeatures.presentWait && mSurface != VK_NULL_HANDLE;
+    mLatencyLimiter.init(&mDispatch, mMainDevice.logicalDevice, usePresentWait, std::min(mConfig.maxQueuedFrames, framesInFlight));
+
+    // Uploads go on the transfer queue when graphics can wait on it with a timeline semaphore
+    mStaging.init(&mAllocator, &mDispatch, mMainDevice.logicalDevice,
+                  mTransferQueue, static_cast<uint32_t>(mQueueFamilyIndices.transferFamily),
+                  mGraphicsQueue, static_cast<uint32_t>(mQueueFamilyIndices.graphicsFamily),
+                  mEnabledFeatures.timelineSemaphore);
+
+    // Uploads are only submitted while drawing, so an on demand loop has to draw again to deliver them
+    mStaging.setUploadCallback([this]() { requestRedraw(); });
+
+    // Layouts the host can copy into, textures left in any other layout go through staging
+    std::vector<VkImageLayout> hostCopyDstLayouts;
+    if (mEnabledFeatures.hostImageCopy)
+    {
+        VkPhysicalDeviceHostImageCopyPropertiesEXT hostImageCopyProperties = {};
+        hostImageCopyProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT;
+
+        VkPhysicalDeviceProperties2 properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &hostImageCopyProperties;
+        vkGetPhysicalDeviceProperties2(mMainDevice.physicalDevice, &properties);
+
+        hostCopyDstLayouts.resize(hostImageCopyProperties.copyDstLayoutCount);
+        hostImageCopyProperties.pCopyDstLayouts = hostCopyDstLayouts.data();
+        hostImageCopyProperties.copySrcLayoutCount = 0;
+        vkGetPhysicalDeviceProperties2(mMainDevice.physicalDevice, &properties);
+        hostCopyDstLayouts.resize(hostImageCopyProperties.copyDstLayoutCount);
+    }
+    mTextureUploader.init(&mDispatch, mMainDevice.physicalDevice, mMainDevice.logicalDevice, &mStaging,
+                          mEnabledFeatures.hostImageCopy, hostCopyDstLayouts);
+}
+
+void VulkanRenderer::createGeometryPass()
+{
+    // Vertices are read through buffer device addresses, and the pipeline is built for dynamic rendering (there are no render passes)
+    if (!mConfig.vertexPulling)
+        return;
+    if (!mEnabledFeatures.bufferDeviceAddress || !mEnabledFeatures.dynamicRendering)
+    {
+        printf("Vertex pulling disabled (needs buffer device address and dynamic rendering)\n");
+        return;
+    }
+
+    // Geometry is only drawn into the scene target, which needs transfers to the output and a format that can be blitted
+    VkFormat outputFormat = mSwapchain != VK_NULL_HANDLE ? mSwapchainImageFormat : mOffscreenFormat;
+    bool canWriteOutput = mSwapchain == VK_NULL_HANDLE || mSwapchainSupportsTransfer;
+    if (!canWriteOutput || !supportsSceneBlit(outputFormat))
+    {
+        printf("Vertex pulling disabled (output can't be blitted to from a scene target)\n");
+        return;
+    }
+
+    // Shaders are compiled at build time, without them the scene is only cleared
+    MappedFile vertexCode;
+    MappedFile fragmentCode;
+    if (!vertexCode.open(mConfig.shaderDirectory + "/geometry.vert.spv") || !fragmentCode.open(mConfig.shaderDirectory + "/geometry.frag.spv"))
+    {
+        printf("Vertex pulling disabled (shaders not found in \"%s\")\n", mConfig.shaderDirectory.c_str());
+        return;
+    }
+    mGeometryVertexShader = createShaderModule(vertexCode);
+    mGeometryFragmentShader = createShaderModule(fragmentCode);
+
+    // Every draw's buffers arrive as 64-bit addresses in push constants, so there are no descriptor sets to bind
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(GeometryPushConstants);
+
+    VkPipelineLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (mDispatch.vkCreatePipelineLayout(mMainDevice.logicalDevice, &layoutInfo, mDispatch.allocator, &mGeometryPipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Pipeline Layout!");
+    }
+
+    // Built now rather than on the first frame, the output format only changes if the swapchain is recreated with another one
+    createGeometryPipeline(outputFormat);
+
+    // -- MESH --
+    // Hexagon around the origin, centre vertex first, indexed as a fan of triangles
+    const uint32_t rimColours[6] = { 0xFF0000FF, 0xFF00FFFF, 0xFF00FF00, 0xFFFFFF00, 0xFFFF0000, 0xFFFF00FF };
+    std::vector<PulledVertex> vertices;
+    std::vector<uint32_t> indices;
+    vertices.push_back({ { 0.0f, 0.0f }, 0xFFFFFFFF, 0 });
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        float angle = static_cast<float>(i) * 3.14159265f / 3.0f;
+        vertices.push_back({ { std::cos(angle), std::sin(angle) }, rimColours[i], 0 });
+        indices.push_back(0);
+        indices.push_back(1 + i);
+        indices.push_back(1 + (i + 1) % 6);
+    }
+
+    mGeometry.init(&mAllocator, &mDispatch, mMainDevice.logicalDevice, &mStaging, mConfig.geometryBufferSize);
+    mMeshVertices = mGeometry.upload(vertices.data(), vertices.size() * sizeof(PulledVertex)).address;
+    mMeshIndices = mGeometry.upload(indices.data(), indices.size() * sizeof(uint32_t)).address;
+    mMeshIndexCount = static_cast<uint32_t>(indices.size());
+    if (mMeshVertices == 0 || mMeshIndices == 0)
+    {
+        throw std::runtime_error("Geometry Buffer too small for the scene mesh!");
+    }
+}
+
+void VulkanRenderer::createGeometryPipeline(VkFormat colourFormat)
+{
+    // Frames in flight may still be drawing with the old one
+    if (mGeometryPipeline != VK_NULL_HANDLE)
+    {
+        VkDevice device = mMainDevice.logicalDevice;
+        VkPipeline oldPipeline = mGeometryPipeline;
+        deferDestroy([this, device, oldPipeline]() { mDispatch.vkDestroyPipeline(device, oldPipeline, mDispatch.allocator); });
+        mGeometryPipeline = VK_NULL_HANDLE;
+    }
+
+    VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = mGeometryVertexShader;
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = mGeometryFragmentShader;
+    shaderStages[1].pName = "main";
+
+    // No bindings or attributes: the vertex shader fetches its own data, so vertex layouts never multiply the pipeline count
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    // Viewport and scissor are dynamic, the scene size changes with the resolution scale
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState colourBlendAttachment = {};
+    colourBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo colourBlending = {};
+    colourBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colourBlending.attachmentCount = 1;
+    colourBlending.pAttachments = &colourBlendAttachment;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    // Dynamic rendering: only the attachment formats are baked in, no render pass
+    VkPipelineRenderingCreateInfo renderingInfo = {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &colourFormat;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &renderingInfo;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colourBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = mGeometryPipelineLayout;
+
+    if (mDispatch.vkCreateGraphicsPipelines(mMainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, mDispatch.allocator, &mGeometryPipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Graphics Pipeline!");
+    }
+    mGeometryPipelineFormat = colourFormat;
+}
+
+VkShaderModule VulkanRenderer::createShaderModule(const MappedFile& code)
+{
+    // SPIR-V is a stream of 32-bit words, the mapping is page aligned so it can be passed straight through
+    if (code.getSize() == 0 || code.getSize() % sizeof(uint32_t) != 0)
+    {
+        throw std::runtime_error("Shader file is not valid SPIR-V!");
+    }
+
+    VkShaderModuleCreateInfo shaderModuleInfo = {};
+    shaderModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderModuleInfo.codeSize = code.getSize();
+    shaderModuleInfo.pCode = reinterpret_cast<const uint32_t*>(code.getData());
+
+    VkShaderModule shaderModule;
+    if (mDispatch.vkCreateShaderModule(mMainDevice.logicalDevice, &shaderModuleInfo, mDispatch.allocator, &shaderModule) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Shader Module!");
+    }
+    return shaderModule;
+}
+
+StagingManager::GraphicsWait VulkanRenderer::recordCommands(FrameContext &frame, VkImage targetImage, VkImageLayout finalLayout, VkExtent2D outputExtent, ReadbackBuffer *readback)
+{
+    // Whole pool is reset at once, rather than resetting command buffers individually
+    mDispatch.vkResetCommandPool(mMainDevice.logicalDevice, frame.commandPool, 0);
+
+    // Information about how to begin each command buffer
+    VkCommandBufferBeginInfo bufferBeginInfo = {};
+    bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;   // Recorded fresh every frame
+
+    VkCommandBuffer commandBuffer = frame.commandBuffer;
+    if (mDispatch.vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to start recording a Command Buffer!");
+    }
+
+    // GPU time for the frame, read back once the frame's fence has signalled (see readFrameTimestamps)
+    bool writeTimestamps = mTimestampQueryPool != VK_NULL_HANDLE;
+    if (writeTimestamps)
+    {
+        mDispatch.vkCmdResetQueryPool(commandBuffer, mTimestampQueryPool, frame.timestampQuery, 2);
+        mDispatch.vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mTimestampQueryPool, frame.timestampQuery);
+    }
+    frame.timestampsWritten = writeTimestamps;
+
+    // Take ownership of anything uploaded on the transfer queue before it's used
+    StagingManager::GraphicsWait stagingWait = mStaging.recordGraphicsAcquire(commandBuffer);
+
+    VkImageSubresourceRange colourRange = {};
+    colourRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    colourRange.levelCount = 1;
+    colourRange.layerCount = 1;
+
+    // Layout transition of a whole colour image
+    auto transition = [&](VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                          VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+    {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = colourRange;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        mDispatch.vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    };
+
+    // Clear to a colour that slowly changes, so it's visible that frames are being drawn
+    float phase = static_cast<float>(frame.frameNumber % 360) / 360.0f;
+    VkClearColorValue clearColour = {};
+    clearColour.float32[0] = phase;
+    clearColour.float32[1] = 0.3f;
+    clearColour.float32[2] = 1.0f - phase;
+    clearColour.float32[3] = 1.0f;
+
+    // Previous contents of the output aren't needed, so transitions start from UNDEFINED
+    // Source stage/access also orders this after any earlier frame's writes to the same image
+    bool canWriteOutput = mSwapchain == VK_NULL_HANDLE || mSwapchainSupportsTransfer;
+    if (!canWriteOutput)
+    {
+        // Swapchain images don't allow transfers, all that can be done is the transition to present
+        transition(targetImage, VK_IMAGE_LAYOUT_UNDEFINED, finalLayout,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+    }
+    else if (!mSceneBlitSupported)
+    {
+        // No scaling possible, scene is cleared straight into the output at full resolution
+        transition(targetImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+        mDispatch.vkCmdClearColorImage(commandBuffer, targetImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColour, 1, &colourRange);
+    }
+    else
+    {
+        // -- SCENE --
+        // Drawn at mSceneExtent into the top left of the scene target, the last frame's blit must have finished reading it
+        if (mEnabledFeatures.dynamicRendering)
+        {
+            transition(mSceneTarget.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+
+            // Render area limits the clear (and any drawing) to the scaled region, so smaller scales cost less
+            VkRenderingAttachmentInfo colourAttachment = {};
+            colourAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+            colourAttachment.imageView = mSceneTarget.imageView;
+            colourAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            colourAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            colourAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            colourAttachment.clearValue.color = clearColour;
+
+            VkRenderingInfo renderingInfo = {};
+            renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+            renderingInfo.renderArea = { { 0, 0 }, mSceneExtent };
+            renderingInfo.layerCount = 1;
+            renderingInfo.colorAttachmentCount = 1;
+            renderingInfo.pColorAttachments = &colourAttachment;
+
+            mDispatch.vkCmdBeginRendering(commandBuffer, &renderingInfo);
+            recordGeometry(frame, commandBuffer);
+            mDispatch.vkCmdEndRendering(commandBuffer);
+
+            transition(mSceneTarget.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+        }
+        else
+        {
+            // Without dynamic rendering the clear covers the whole target, only the blit gets cheaper
+            transition(mSceneTarget.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+            mDispatch.vkCmdClearColorImage(commandBuffer, mSceneTarget.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColour, 1, &colourRange);
+            transition(mSceneTarget.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+        }
+
+        // -- UPSCALE --
+        transition(targetImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+        VkImageBlit blitRegion = {};
+        blitRegion.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        blitRegion.srcOffsets[1] = { static_cast<int32_t>(mSceneExtent.width), static_cast<int32_t>(mSceneExtent.height), 1 };
+        blitRegion.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        blitRegion.dstOffsets[1] = { static_cast<int32_t>(outputExtent.width), static_cast<int32_t>(outputExtent.height), 1 };
+        mDispatch.vkCmdBlitImage(commandBuffer, mSceneTarget.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                 targetImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blitRegion, mSceneBlitFilter);
+    }
+
+    // -- READBACK --
+    // Output is now in TRANSFER_DST, copy it out at the very end of the frame so nothing waits on it
+    if (canWriteOutput && readback != nullptr)
+    {
+        transition(targetImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+        VkBufferImageCopy copyRegion = {};
+        copyRegion.bufferOffset = 0;
+        copyRegion.bufferRowLength = 0;                                     // Tightly packed
+        copyRegion.bufferImageHeight = 0;
+        copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        copyRegion.imageExtent = { outputExtent.width, outputExtent.height, 1 };
+        mDispatch.vkCmdCopyImageToBuffer(commandBuffer, targetImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback->storage.buffer, 1, &copyRegion);
+
+        // Make the copy visible to the host once the fence signals
+        VkBufferMemoryBarrier bufferBarrier = {};
+        bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.buffer = readback->storage.buffer;
+        bufferBarrier.offset = 0;
+        bufferBarrier.size = VK_WHOLE_SIZE;
+        mDispatch.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                                       0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+        if (finalLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+        {
+            transition(targetImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, finalLayout,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+        }
+    }
+    else if (canWriteOutput)
+    {
+        // Transition to the layout it's used in next (presenting, or copying out)
+        transition(targetImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+    }
+
+    if (writeTimestamps)
+    {
+        mDispatch.vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mTimestampQueryPool, frame.timestampQuery + 1);
+    }
+
+    // Hand images with kept contents to the transfer queue once this frame is done with them, and close the uploads
+    // queued during recording into a batch for the next frame (this submit signals mFrameNumber + 1 on the graphics timeline)
+    mStaging.recordGraphicsRelease(commandBuffer, mFrameNumber + 1);
+
+    // Stop recording to command buffer
+    if (mDispatch.vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to stop recording a Command Buffer!");
+    }
+
+    return stagingWait;
+}
+
+void VulkanRenderer::recordGeometry(FrameContext &frame, VkCommandBuffer commandBuffer)
+{
+    if (mGeometryPipeline == VK_NULL_HANDLE || mGeometryPipelineFormat != mSceneFormat)
+        return;
+
+    // Instances move every frame, so they go in the frame's upload arena rather than the geometry buffer
+    constexpr uint32_t instanceCount = GeometryGridSize * GeometryGridSize;
+    UploadArena::Allocation instanceData = frame.uploads.allocate(instanceCount * sizeof(PulledInstance));
+    if (instanceData.data == nullptr)
+        return;
+
+    PulledInstance *instances = static_cast<PulledInstance*>(instanceData.data);
+    float phase = static_cast<float>(mFrameNumber % 100000) * 0.02f;
+    for (uint32_t i = 0; i < instanceCount; i++)
+    {
+        instances[i].offset[0] = (static_cast<float>(i % GeometryGridSize) + 0.5f) / GeometryGridSize * 2.0f - 1.0f;
+        instances[i].offset[1] = (static_cast<float>(i / GeometryGridSize) + 0.5f) / GeometryGridSize * 2.0f - 1.0f;
+        instances[i].scale = 0.8f / GeometryGridSize;
+        instances[i].rotation = phase * (1.0f + 0.05f * static_cast<float>(i));
+    }
+
+    // Whole scene is one pipeline bind and one push, no vertex, index or descriptor bindings
+    GeometryPushConstants pushConstants = {};
+    pushConstants.vertices = mMeshVertices;
+    pushConstants.indices = mMeshIndices;
+    pushConstants.instances = instanceData.address;
+    pushConstants.aspect = static_cast<float>(mSceneExtent.height) / static_cast<float>(mSceneExtent.width);
+
+    VkViewport viewport = { 0.0f, 0.0f, static_cast<float>(mSceneExtent.width), static_cast<float>(mSceneExtent.height), 0.0f, 1.0f };
+    VkRect2D scissor = { { 0, 0 }, mSceneExtent };
+
+    mDispatch.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGeometryPipeline);
+    mDispatch.vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    mDispatch.vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    mDispatch.vkCmdPushConstants(commandBuffer, mGeometryPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants), &pushConstants);
+    mDispatch.vkCmdDraw(commandBuffer, mMeshIndexCount, instanceCount, 0, 0);
+    mPulledDraws++;
+}
+
+void VulkanRenderer::readFrameTimestamps(FrameContext &frame)
+{
+    if (!frame.timestampsWritten)
+        return;
+
+    // Frame's fence has signalled, so results are available without waiting
+    uint64_t timestamps[2];
+    VkResult result = mDispatch.vkGetQueryPoolResults(mMainDevice.logicalDevice, mTimestampQueryPool, frame.timestampQuery, 2,
+                                                      sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    frame.timestampsWritten = false;
+    if (result != VK_SUCCESS)
+        return;
+
+    uint64_t ticks = (timestamps[1] - timestamps[0]) & mTimestampMask;
+    double gpuTimeMs = static_cast<double>(ticks) * mTimestampPeriod / 1000000.0;
+    mResolution.update(gpuTimeMs);
+}
+
+void VulkanRenderer::updateSceneTarget(VkExtent2D outputExtent, VkFormat outputFormat)
+{
+    // Size dependent, so rebuilt lazily the first time it's needed after the output changes
+    if (mSceneTarget.image == VK_NULL_HANDLE || mSceneTargetGeneration != mSwapchainGeneration || mSceneFormat != outputFormat)
+    {
+        // Frames still in flight may be drawing to the old one
+        if (mSceneTarget.image != VK_NULL_HANDLE)
+        {
+            // Back to the pool, e.g. a resize there and back picks it up again once the frames using it are done
+            mResourcePool.release(mSceneTarget, mFrameNumber);
+        }
+
+        // Scene is upscaled with a blit, so the format must support blitting both ways (and filtering, for a smooth upscale)
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(mMainDevice.physicalDevice, outputFormat, &formatProperties);
+        mSceneBlitSupported = supportsSceneBlit(outputFormat);
+        mSceneBlitFilter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+        mSceneFormat = outputFormat;
+        mSceneTargetGeneration = mSwapchainGeneration;
+
+        // Pipeline is built against the colour format, so it only needs rebuilding if the output format changed
+        if (mGeometryPipelineLayout != VK_NULL_HANDLE && mGeometryPipelineFormat != mSceneFormat)
+        {
+            createGeometryPipeline(mSceneFormat);
+        }
+        if (mSceneBlitSupported)
+        {
+            // Allocated at the largest scale, so changing scale never reallocates
+            float maxScale = mConfig.maxResolutionScale;
+            mSceneTargetExtent.width = std::max(1u, static_cast<uint32_t>(std::ceil(outputExtent.width * maxScale)));
+            mSceneTargetExtent.height = std::max(1u, static_cast<uint32_t>(std::ceil(outputExtent.height * maxScale)));
+            ResourcePool::ImageDesc desc;
+            desc.extent = { mSceneTargetExtent.width, mSceneTargetExtent.height, 1 };
+            desc.format = mSceneFormat;
+            desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+            mSceneTarget = mResourcePool.acquireImage(desc);
+        }
+    }
+
+    // Region of the target drawn this frame
+    float scale = mResolution.getScale();
+    mSceneExtent.width = std::max(1u, std::min(mSceneTargetExtent.width, static_cast<uint32_t>(outputExtent.width * scale + 0.5f)));
+    mSceneExtent.height = std::max(1u, std::min(mSceneTargetExtent.height, static_cast<uint32_t>(outputExtent.height * scale + 0.5f)));
+}
+
+bool VulkanRenderer::supportsSceneBlit(VkFormat format)
+{
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(mMainDevice.physicalDevice, format, &formatProperties);
+    VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT;
+    return (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+}
+
+void VulkanRenderer::createSwapchain()
+{
+    // Nothing to present to without a surface (offscreen images are used instead)
+    if (mSurface == VK_NULL_HANDLE)
+        return;
+
+    // Get Swap Chain details so we can pick best settings
+    SwapChainDetails swapChainDetails = getSwapChainDetails(mMainDevice.physicalDevice);
+
+    // Find optimal surface values for our swap chain
+    VkSurfaceFormatKHR surfaceFormat = chooseBestSurfaceFormat(swapChainDetails.formats);
+    VkPresentModeKHR presentMode = chooseBestPresentationMode(swapChainDetails.presentationModes);
+    VkExtent2D extent = chooseSwapExtent(swapChainDetails.surfaceCapabilities);
+    uint32_t imageCount = chooseSwapchainImageCount(swapChainDetails.surfaceCapabilities, presentMode);
+
+    // Creation information for swap chain
+    VkSwapchainCreateInfoKHR swapChainCreateInfo = {};
+    swapChainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    swapChainCreateInfo.surface = mSurface;                                                     // Swapchain surface
+    swapChainCreateInfo.imageFormat = surfaceFormat.format;                                     // Swapchain format
+    swapChainCreateInfo.imageColorSpace = surfaceFormat.colorSpace;                             // Swapchain colour space
+    swapChainCreateInfo.presentMode = presentMode;                                              // Swapchain presentation mode
+    swapChainCreateInfo.imageExtent = extent;                                                   // Swapchain image extents
+    swapChainCreateInfo.minImageCount = imageCount;                                             // Minimum images in swapchain
+    swapChainCreateInfo.imageArrayLayers = 1;                                                   // Number of layers for each image in chain
+    swapChainCreateInfo.preTransform = swapChainDetails.surfaceCapabilities.currentTransform;   // Transform to perform on swap chain images
+    swapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;                     // How to handle blending images with external graphics (e.g. other windows)
+    swapChainCreateInfo.clipped = VK_TRUE;                                                      // Whether to clip parts of image not in view (e.g. behind another window, off screen, etc)
+
+    // Images are drawn to, and cleared/blitted to with transfer commands where supported
+    swapChainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    mSwapchainSupportsTransfer = swapChainDetails.surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if (mSwapchainSupportsTransfer)
+    {
+        swapChainCreateInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+
+    // Images are copied out when capturing frames
+    mSwapchainSupportsReadback = swapChainDetails.surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    if (!mConfig.capturePath.empty() && mSwapchainSupportsReadback)
+    {
+        swapChainCreateInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+
+    // If Graphics and Presentation families are different, then swapchain must let images be shared between families
+    uint32_t queueFamilyIndices[] = {
+        (uint32_t)mQueueFamilyIndices.graphicsFamily,
+        (uint32_t)mQueueFamilyIndices.presentationFamily
+    };
+    if (mQueueFamilyIndices.graphicsFamily != mQueueFamilyIndices.presentationFamily)
+    {
+        swapChainCreateInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;      // Image share handling
+        swapChainCreateInfo.queueFamilyIndexCount = 2;                          // Number of queues to share images between
+        swapChainCreateInfo.pQueueFamilyIndices = queueFamilyIndices;           // Array of queues to share between
+    }
+    else
+    {
+        swapChainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        swapChainCreateInfo.queueFamilyIndexCount = 0;
+        swapChainCreateInfo.pQueueFamilyIndices = nullptr;
+    }
+
+    // If this replaces an existing swap chain, link old one to quickly hand over responsibilities
+    swapChainCreateInfo.oldSwapchain = mSwapchain;
+
+    // Create Swapchain
+    VkSwapchainKHR newSwapchain;
+    VkResult result = mDispatch.vkCreateSwapchainKHR(mMainDevice.logicalDevice, &swapChainCreateInfo, mDispatch.allocator, &newSwapchain);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Swapchain!");
+    }
+
+    // Old swapchain can't be acquired from any more, but its queued presents may still be using it
+    // (a frame's fence only covers its rendering, not the present after it), see collectRetiredSwapchains
+    if (mSwapchain != VK_NULL_HANDLE)
+    {
+        RetiredSwapchain retired = {};
+        retired.swapchain = mSwapchain;
+        retired.images = std::move(mSwapchainImages);
+        retired.presentFences = std::move(mPresentFences);
+        mRetiredSwapchains.push_back(std::move(retired));
+        mSwapchainImages.clear();
+        mPresentFences.clear();
+    }
+    mSwapchain = newSwapchain;
+
+    // Store for later reference
+    mSwapchainImageFormat = surfaceFormat.format;
+    mSwapchainExtent = extent;
+    mPresentMode = presentMode;
+
+    // Get swap chain images (first count, then values)
+    uint32_t swapChainImageCount;
+    mDispatch.vkGetSwapchainImagesKHR(mMainDevice.logicalDevice, mSwapchain, &swapChainImageCount, nullptr);
+    std::vector<VkImage> images(swapChainImageCount);
+    mDispatch.vkGetSwapchainImagesKHR(mMainDevice.logicalDevice, mSwapchain, &swapChainImageCount, images.data());
+
+    VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+    semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    for (VkImage image : images)
+    {
+        // Store image handle
+        SwapchainImage swapChainImage = {};
+        swapChainImage.image = image;
+        swapChainImage.imageView = createImageView(image, mSwapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+        if (mDispatch.vkCreateSemaphore(mMainDevice.logicalDevice, &semaphoreCreateInfo, mDispatch.allocator, &swapChainImage.renderFinished) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create a Semaphore!");
+        }
+
+        // Add to swapchain image list
+        mSwapchainImages.push_back(swapChainImage);
+    }
+
+    printf("Swapchain: %ux%u, %u images, present mode %d\n", extent.width, extent.height, swapChainImageCount, presentMode);
+}
+
 void VulkanRenderer::getPhysicalDevice()
 {
     // Enumerate Physical devices the vkInstance can access
@@ -223,14 +1737,86 @@ void VulkanRenderer::getPhysicalDevice()
     std::vector<VkPhysicalDevice> deviceList(deviceCount);
     vkEnumeratePhysicalDevices(mInstance, &deviceCount, deviceList.data());
 
+    // Score every suitable device, so the best one is chosen rather than the first one found
+    std::vector<DeviceScore> candidates;
     for (const auto &device : deviceList)
     {
         if (checkDeviceSuitable(device))
         {
-            mMainDevice.physicalDevice = device;
-            break;
+            candidates.push_back(scoreDevice(device));
+        }
+    }
+
+    if (candidates.empty())
+    {
+        throw std::runtime_error("Can't find a suitable GPU!");
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(), [](const DeviceScore &a, const DeviceScore &b)
+    {
+        return a.total() > b.total();
+    });
+
+    // Break ties between devices that scored close to the best with a short benchmark
+    if (mConfig.deviceBenchmark && candidates.size() > 1)
+    {
+        int bestTotal = candidates[0].total();
+        size_t tiedCount = 0;
+        while (tiedCount < candidates.size() && bestTotal - candidates[tiedCount].total() <= mConfig.deviceTieRange)
+        {
+            candidates[tiedCount].benchmarkScore = benchmarkDevice(candidates[tiedCount].device);
+            tiedCount++;
+        }
+
+        std::stable_sort(candidates.begin(), candidates.begin() + tiedCount, [](const DeviceScore &a, const DeviceScore &b)
+        {
+            return a.benchmarkScore > b.benchmarkScore;
+        });
+    }
+
+    printf("Suitable devices:\n");
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        const DeviceScore &candidate = candidates[i];
+        printf("  [%zu] %s: total %d (type %d, memory %d, queues %d, features %d, limits %d, benchmark %.2f GB/s)\n",
+               i, candidate.name.c_str(), candidate.total(), candidate.typeScore, candidate.memoryScore,
+               candidate.queueScore, candidate.featureScore, candidate.limitScore, candidate.benchmarkScore);
+    }
+
+    // Highest scored device, unless one is forced by index or name (environment variable takes priority over config)
+    const DeviceScore *chosen = &candidates[0];
+    const char *environmentOverride = getenv("LV_DEVICE");
+    std::string deviceOverride = environmentOverride != nullptr ? environmentOverride : mConfig.deviceOverride;
+    if (!deviceOverride.empty())
+    {
+        const DeviceScore *forced = nullptr;
+        char *end = nullptr;
+        unsigned long index = strtoul(deviceOverride.c_str(), &end, 10);
+        if (*end == '\0' && index < candidates.size())
+        {
+            forced = &candidates[index];
+        }
+        else
+        {
+            for (const auto &candidate : candidates)
+            {
+                if (candidate.name.find(deviceOverride) != std::string::npos)
+                {
+                    forced = &candidate;
+                    break;
+                }
+            }
         }
+
+        if (forced == nullptr)
+        {
+            throw std::runtime_error("Forced device \"" + deviceOverride + "\" is not a suitable device!");
+        }
+        chosen = forced;
     }
+
+    printf("Using device: %s (score %d%s)\n", chosen->name.c_str(), chosen->total(), deviceOverride.empty() ? "" : ", forced");
+    mMainDevice.physicalDevice = chosen->device;
 }
 
 bool VulkanRenderer::checkInstanceExtensionsSupport(std::vector<const char *> *checkExtensions)
@@ -256,105 +1842,702 @@ bool VulkanRenderer::checkInstanceExtensionsSupport(std::vector<const char *> *c
             }
         }
 
-        if (!hasExtension)
-        {
-            return false;
-        }
+        if (!hasExtension)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool VulkanRenderer::checkDeviceExtensionSupport(VkPhysicalDevice device)
+{
+    std::vector<const char*> requiredExtensions = getRequiredDeviceExtensions();
+
+    // Get device extension count
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    // If no extensions found, return failure (unless none are needed)
+    if (extensionCount == 0)
+        return requiredExtensions.empty();
+
+    // Populate list of extensions
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+    // Check for extension
+    for (const auto& deviceExtension : requiredExtensions)
+    {
+        bool hasExtension = false;
+        for (const auto &extension : extensions)
+        {
+            if (strcmp(deviceExtension, extension.extensionName) == 0)
+            {
+                hasExtension = true;
+                break;
+            }
+        }
+
+        if (!hasExtension)
+            return false;
+    }
+
+    return true;
+}
+
+bool VulkanRenderer::checkValidationFeaturesSupport()
+{
+    // Extension comes from the validation layer, so ask the layer rather than the implementation
+    uint32_t extensionCount = 0;
+    vkEnumerateInstanceExtensionProperties(validationLayers[0], &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateInstanceExtensionProperties(validationLayers[0], &extensionCount, extensions.data());
+
+    for (const auto &extension : extensions)
+    {
+        if (strcmp(extension.extensionName, VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+bool VulkanRenderer::checkValidationLayerSupport()
+{
+    // Get number of validation layers to create vector of appropriate size
+    uint32_t validationLayerCount;
+    vkEnumerateInstanceLayerProperties(&validationLayerCount, nullptr);
+
+    // Check if no validation layers found AND we want at least 1 layer
+    if (validationLayerCount == 0 && validationLayers.size() > 0)
+        return false;
+
+    std::vector<VkLayerProperties> availableLayers(validationLayerCount);
+    vkEnumerateInstanceLayerProperties(&validationLayerCount, availableLayers.data());
+
+    // Check if given Validation layer is in list of given Validation Layers
+    for (const auto &validationLayer : validationLayers)
+    {
+        bool hasLayer = false;
+        for (const auto &availableLayer : availableLayers)
+        {
+            if (strcmp(validationLayer, availableLayer.layerName) == 0)
+            {
+                hasLayer = true;
+                break;
+            }
+        }
+
+        if (!hasLayer)
+            return false;
+    }
+
+    return true;
+}
+
+bool VulkanRenderer::checkDeviceSuitable(VkPhysicalDevice device)
+{
+    /*
+    // Information about the device itself (ID, name, type, vendor, etc)
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+    // Information about what the device can do (geo shader, tess shader, wide lines, etc)
+    VkPhysicalDeviceFeatures deviceFeatures;
+    vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+    */
+
+    QueueFamilyIndices indices = getQueueFamilies(device);
+
+    bool extensionsSupported = checkDeviceExtensionSupport(device);
+
+    // Without a surface nothing is presented, so there is no swapchain to validate
+    bool hasSurface = mSurface != VK_NULL_HANDLE;
+    bool swapChainValid = !hasSurface;
+    if (extensionsSupported && hasSurface)
+    {
+        SwapChainDetails swapChainDetails = getSwapChainDetails(device);
+        swapChainValid = !swapChainDetails.presentationModes.empty() && !swapChainDetails.formats.empty();
+    }
+    return indices.isValid(hasSurface) && extensionsSupported && swapChainValid;
+}
+
+std::vector<const char*> VulkanRenderer::getOptionalDeviceExtensions()
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(mMainDevice.physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(mMainDevice.physicalDevice, nullptr, &extensionCount, extensions.data());
+
+    auto isSupported = [&](const char *extensionName)
+    {
+        for (const auto &extension : extensions)
+        {
+            if (strcmp(extensionName, extension.extensionName) == 0)
+                return true;
+        }
+        return false;
+    };
+
+    std::vector<const char*> optionalExtensions;
+
+    // Presentation extensions need the swapchain extension, and their features need vkGetPhysicalDeviceFeatures2
+    if (mSurface != VK_NULL_HANDLE && mInstanceApiVersion >= VK_API_VERSION_1_1)
+    {
+        for (const char *extension : optionalPresentationExtensions)
+        {
+            if (strcmp(extension, VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME) == 0 && !mSurfaceMaintenanceSupported)
+                continue;
+
+            if (isSupported(extension))
+            {
+                optionalExtensions.push_back(extension);
+            }
+        }
+    }
+
+    // Host image copy depends on copy_commands2 and format_feature_flags2, which are core in 1.3
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(mMainDevice.physicalDevice, &deviceProperties);
+    if (mInstanceApiVersion >= VK_API_VERSION_1_3 && deviceProperties.apiVersion >= VK_API_VERSION_1_3)
+    {
+        for (const char *extension : optionalUploadExtensions)
+        {
+            if (isSupported(extension))
+            {
+                optionalExtensions.push_back(extension);
+            }
+        }
+    }
+
+    // Budgets are read through vkGetPhysicalDeviceMemoryProperties2
+    if (mInstanceApiVersion >= VK_API_VERSION_1_1)
+    {
+        for (const char *extension : optionalMemoryExtensions)
+        {
+            if (isSupported(extension))
+            {
+                optionalExtensions.push_back(extension);
+            }
+        }
+    }
+
+    return optionalExtensions;
+}
+
+bool VulkanRenderer::isDeviceExtensionEnabled(const char *extensionName)
+{
+    for (const char *extension : mEnabledDeviceExtensions)
+    {
+        if (strcmp(extension, extensionName) == 0)
+            return true;
+    }
+    return false;
+}
+
+std::vector<const char*> VulkanRenderer::getRequiredDeviceExtensions()
+{
+    // Swapchain extension is only needed if there is a surface to present to
+    if (mSurface == VK_NULL_HANDLE)
+        return {};
+
+    return deviceExtensions;
+}
+
+void VulkanRenderer::negotiateDeviceFeatures(FeatureChain &enabledFeatures)
+{
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(mMainDevice.physicalDevice, &deviceProperties);
+
+    // Can only use what both the instance and device support
+    uint32_t deviceVersion = VK_MAKE_API_VERSION(0, VK_API_VERSION_MAJOR(deviceProperties.apiVersion), VK_API_VERSION_MINOR(deviceProperties.apiVersion), 0);
+    mEnabledFeatures = DeviceFeatures();
+    mEnabledFeatures.apiVersion = std::min(deviceVersion, mInstanceApiVersion);
+    uint32_t apiVersion = mEnabledFeatures.apiVersion;
+
+    // Build the same chain twice, once to query support and once to enable features
+    // Feature structs for newer versions are only valid on drivers that support them, so 1.0/1.1 drivers get a shorter chain
+    FeatureChain supportedFeatures;
+    for (FeatureChain *chain : { &supportedFeatures, &enabledFeatures })
+    {
+        if (apiVersion >= VK_API_VERSION_1_2)
+        {
+            chain->add<VkPhysicalDeviceVulkan11Features>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES);
+            chain->add<VkPhysicalDeviceVulkan12Features>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES);
+        }
+        else if (apiVersion >= VK_API_VERSION_1_1)
+        {
+            chain->add<VkPhysicalDevice16BitStorageFeatures>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES);
+        }
+
+        if (apiVersion >= VK_API_VERSION_1_3)
+        {
+            chain->add<VkPhysicalDeviceVulkan13Features>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES);
+        }
+
+        // Extension features, only if the extension is being enabled
+        if (apiVersion >= VK_API_VERSION_1_1 && isDeviceExtensionEnabled(VK_KHR_PRESENT_ID_EXTENSION_NAME))
+        {
+            chain->add<VkPhysicalDevicePresentIdFeaturesKHR>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR);
+        }
+        if (apiVersion >= VK_API_VERSION_1_1 && isDeviceExtensionEnabled(VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+        {
+            chain->add<VkPhysicalDevicePresentWaitFeaturesKHR>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR);
+        }
+        if (apiVersion >= VK_API_VERSION_1_1 && isDeviceExtensionEnabled(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME))
+        {
+            chain->add<VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT);
+        }
+        if (apiVersion >= VK_API_VERSION_1_3 && isDeviceExtensionEnabled(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME))
+        {
+            chain->add<VkPhysicalDeviceHostImageCopyFeaturesEXT>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT);
+        }
+    }
+
+    if (apiVersion >= VK_API_VERSION_1_1)
+    {
+        vkGetPhysicalDeviceFeatures2(mMainDevice.physicalDevice, &supportedFeatures.root());
+    }
+    else
+    {
+        vkGetPhysicalDeviceFeatures(mMainDevice.physicalDevice, &supportedFeatures.root().features);
+    }
+
+    // Enable a feature only if supported, and record whether it was enabled
+    auto enable = [](VkBool32 supported, VkBool32 &enabled) -> bool
+    {
+        enabled = supported;
+        return supported == VK_TRUE;
+    };
+
+    // -- VULKAN 1.0 --
+    const VkPhysicalDeviceFeatures &supported10 = supportedFeatures.root().features;
+    VkPhysicalDeviceFeatures &enabled10 = enabledFeatures.root().features;
+    enable(supported10.shaderInt16, enabled10.shaderInt16);
+
+    // -- VULKAN 1.1 --
+    if (auto *supported11 = supportedFeatures.find<VkPhysicalDeviceVulkan11Features>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES))
+    {
+        auto *enabled11 = enabledFeatures.find<VkPhysicalDeviceVulkan11Features>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES);
+        mEnabledFeatures.storageBuffer16BitAccess = enable(supported11->storageBuffer16BitAccess, enabled11->storageBuffer16BitAccess);
+        enable(supported11->uniformAndStorageBuffer16BitAccess, enabled11->uniformAndStorageBuffer16BitAccess);
+    }
+    else if (auto *supported16Bit = supportedFeatures.find<VkPhysicalDevice16BitStorageFeatures>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES))
+    {
+        auto *enabled16Bit = enabledFeatures.find<VkPhysicalDevice16BitStorageFeatures>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES);
+        mEnabledFeatures.storageBuffer16BitAccess = enable(supported16Bit->storageBuffer16BitAccess, enabled16Bit->storageBuffer16BitAccess);
+        enable(supported16Bit->uniformAndStorageBuffer16BitAccess, enabled16Bit->uniformAndStorageBuffer16BitAccess);
+    }
+
+    // -- VULKAN 1.2 --
+    if (auto *supported12 = supportedFeatures.find<VkPhysicalDeviceVulkan12Features>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES))
+    {
+        auto *enabled12 = enabledFeatures.find<VkPhysicalDeviceVulkan12Features>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES);
+        mEnabledFeatures.storageBuffer8BitAccess = enable(supported12->storageBuffer8BitAccess, enabled12->storageBuffer8BitAccess);
+        enable(supported12->uniformAndStorageBuffer8BitAccess, enabled12->uniformAndStorageBuffer8BitAccess);
+        mEnabledFeatures.shaderInt8 = enable(supported12->shaderInt8, enabled12->shaderInt8);
+        mEnabledFeatures.shaderFloat16 = enable(supported12->shaderFloat16, enabled12->shaderFloat16);
+        mEnabledFeatures.timelineSemaphore = enable(supported12->timelineSemaphore, enabled12->timelineSemaphore);
+        // Only place buffer device address is switched on: chain structs start zeroed and VK_KHR_buffer_device_address isn't
+        // requested, so it's enabled exactly when the 1.2 feature is supported
+        mEnabledFeatures.bufferDeviceAddress = enable(supported12->bufferDeviceAddress, enabled12->bufferDeviceAddress);
+
+        // Bindless style descriptor arrays
+        mEnabledFeatures.descriptorIndexing = enable(supported12->descriptorIndexing, enabled12->descriptorIndexing);
+        enable(supported12->runtimeDescriptorArray, enabled12->runtimeDescriptorArray);
+        enable(supported12->descriptorBindingPartiallyBound, enabled12->descriptorBindingPartiallyBound);
+        enable(supported12->descriptorBindingVariableDescriptorCount, enabled12->descriptorBindingVariableDescriptorCount);
+        enable(supported12->descriptorBindingSampledImageUpdateAfterBind, enabled12->descriptorBindingSampledImageUpdateAfterBind);
+        enable(supported12->shaderSampledImageArrayNonUniformIndexing, enabled12->shaderSampledImageArrayNonUniformIndexing);
+    }
+
+    // -- VULKAN 1.3 --
+    if (auto *supported13 = supportedFeatures.find<VkPhysicalDeviceVulkan13Features>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES))
+    {
+        auto *enabled13 = enabledFeatures.find<VkPhysicalDeviceVulkan13Features>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES);
+        mEnabledFeatures.synchronization2 = enable(supported13->synchronization2, enabled13->synchronization2);
+        mEnabledFeatures.dynamicRendering = enable(supported13->dynamicRendering, enabled13->dynamicRendering);
+    }
+
+    // -- EXTENSIONS --
+    if (auto *supportedPresentId = supportedFeatures.find<VkPhysicalDevicePresentIdFeaturesKHR>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR))
+    {
+        auto *enabledPresentId = enabledFeatures.find<VkPhysicalDevicePresentIdFeaturesKHR>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR);
+        mEnabledFeatures.presentId = enable(supportedPresentId->presentId, enabledPresentId->presentId);
+    }
+    if (auto *supportedPresentWait = supportedFeatures.find<VkPhysicalDevicePresentWaitFeaturesKHR>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR))
+    {
+        auto *enabledPresentWait = enabledFeatures.find<VkPhysicalDevicePresentWaitFeaturesKHR>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR);
+        mEnabledFeatures.presentWait = enable(supportedPresentWait->presentWait, enabledPresentWait->presentWait);
+    }
+    if (auto *supportedMaintenance1 = supportedFeatures.find<VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT))
+    {
+        auto *enabledMaintenance1 = enabledFeatures.find<VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT);
+        mEnabledFeatures.swapchainMaintenance1 = enable(supportedMaintenance1->swapchainMaintenance1, enabledMaintenance1->swapchainMaintenance1);
     }
 
-    return true;
+    if (auto *supportedHostImageCopy = supportedFeatures.find<VkPhysicalDeviceHostImageCopyFeaturesEXT>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT))
+    {
+        auto *enabledHostImageCopy = enabledFeatures.find<VkPhysicalDeviceHostImageCopyFeaturesEXT>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT);
+        mEnabledFeatures.hostImageCopy = enable(supportedHostImageCopy->hostImageCopy, enabledHostImageCopy->hostImageCopy);
+    }
+
+    // No features to enable, budgets are read with vkGetPhysicalDeviceMemoryProperties2
+    mEnabledFeatures.memoryBudget = apiVersion >= VK_API_VERSION_1_1 && isDeviceExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    printf("Device features: Vulkan %u.%u, timeline semaphores %d, synchronization2 %d, dynamic rendering %d, buffer device address %d, "
+           "descriptor indexing %d, 8-bit storage %d, 16-bit storage %d, present wait %d, present fences %d, memory budget %d, host image copy %d\n",
+           VK_API_VERSION_MAJOR(apiVersion), VK_API_VERSION_MINOR(apiVersion),
+           mEnabledFeatures.timelineSemaphore, mEnabledFeatures.synchronization2, mEnabledFeatures.dynamicRendering,
+           mEnabledFeatures.bufferDeviceAddress, mEnabledFeatures.descriptorIndexing,
+           mEnabledFeatures.storageBuffer8BitAccess, mEnabledFeatures.storageBuffer16BitAccess,
+           mEnabledFeatures.presentId && mEnabledFeatures.presentWait, mEnabledFeatures.swapchainMaintenance1,
+           mEnabledFeatures.memoryBudget, mEnabledFeatures.hostImageCopy);
 }
 
-bool VulkanRenderer::checkDeviceExtensionSupport(VkPhysicalDevice device)
+OffscreenImage VulkanRenderer::createColourImage(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage)
 {
-    // Get device extension count
-    uint32_t extensionCount = 0;
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    OffscreenImage colourImage = {};
+
+    VkImageCreateInfo imageCreateInfo = {};
+    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageCreateInfo.extent = { extent.width, extent.height, 1 };
+    imageCreateInfo.mipLevels = 1;
+    imageCreateInfo.arrayLayers = 1;
+    imageCreateInfo.format = format;
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageCreateInfo.usage = usage;
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkResult result = mDispatch.vkCreateImage(mMainDevice.logicalDevice, &imageCreateInfo, mDispatch.allocator, &colourImage.image);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Colour Image!");
+    }
 
-    // If no extensions found, return failure
-    if (extensionCount == 0)
-        return false;
+    // Render targets are large and long lived, so they get their own allocation
+    colourImage.allocation = mAllocator.allocateForImage(colourImage.image, MemoryUsage::GpuOnly, true);
 
-    // Populate list of extensions
-    std::vector<VkExtensionProperties> extensions(extensionCount);
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+    colourImage.imageView = createImageView(colourImage.image, format, VK_IMAGE_ASPECT_COLOR_BIT);
 
-    // Check for extension
-    for (const auto& deviceExtension : deviceExtensions)
-    {
-        bool hasExtension = false;
-        for (const auto &extension : extensions)
-        {
-            if (strcmp(deviceExtension, extension.extensionName) == 0)
-            {
-                hasExtension = true;
-                break;
-            }
-        }
+    return colourImage;
+}
 
-        if (!hasExtension)
-            return false;
+void VulkanRenderer::createReadbackBuffer(ReadbackBuffer &readback, VkDeviceSize size)
+{
+    readback = {};
+
+    // Only ever copied into, host cached where possible as CPU reads from uncached memory are very slow
+    ResourcePool::BufferDesc desc;
+    desc.size = size;
+    desc.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    desc.memoryUsage = MemoryUsage::Readback;
+    readback.storage = mResourcePool.acquireBuffer(desc);
+    if (readback.storage.allocation.mapped == nullptr)
+    {
+        throw std::runtime_error("Failed to map Readback Buffer memory!");
     }
+}
 
-    return true;
+void VulkanRenderer::destroyReadbackBuffer(ReadbackBuffer &readback)
+{
+    // Only called once the frame context's fence has signalled, so it can be reused straight away
+    mResourcePool.release(readback.storage, getFramesCompleted());
+    readback = {};
 }
 
-bool VulkanRenderer::checkValidationLayerSupport()
+void VulkanRenderer::drainReadback(ReadbackBuffer &readback)
 {
-    // Get number of validation layers to create vector of appropriate size
-    uint32_t validationLayerCount;
-    vkEnumerateInstanceLayerProperties(&validationLayerCount, nullptr);
+    if (!readback.pending)
+        return;
+    readback.pending = false;
 
-    // Check if no validation layers found AND we want at least 1 layer
-    if (validationLayerCount == 0 && validationLayers.size() > 0)
-        return false;
+    // Encoding slower than capturing would otherwise queue up frame copies without limit
+    if (mPendingCaptures.load() >= std::max(1u, mConfig.maxPendingCaptures))
+    {
+        mCaptureFailures++;
+        return;
+    }
 
-    std::vector<VkLayerProperties> availableLayers(validationLayerCount);
-    vkEnumerateInstanceLayerProperties(&validationLayerCount, availableLayers.data());
+    // Copy out so the buffer can be reused straight away, everything slow happens on a worker
+    size_t byteCount = static_cast<size_t>(readback.extent.width) * readback.extent.height * 4;
+    mAllocator.invalidate(readback.storage.allocation, 0, byteCount);
+    const uint8_t *mapped = readback.storage.allocation.mapped;
+    auto pixels = std::make_shared<std::vector<uint8_t>>(mapped, mapped + byteCount);
 
-    // Check if given Validation layer is in list of given Validation Layers
-    for (const auto &validationLayer : validationLayers)
+    uint32_t width = readback.extent.width;
+    uint32_t height = readback.extent.height;
+    VkFormat format = readback.format;
+    CaptureFormat captureFormat = mConfig.captureFormat;
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "_%06llu.%s", static_cast<unsigned long long>(readback.frameNumber),
+             captureFormat == CaptureFormat::Png ? "png" : "lvri");
+    std::string path = mConfig.capturePath + suffix;
+
+    mPendingCaptures++;
+    mWorkers->submit([this, pixels, width, height, format, captureFormat, path]()
     {
-        bool hasLayer = false;
-        for (const auto &availableLayer : availableLayers)
+        bool written;
+        if (captureFormat == CaptureFormat::Png)
         {
-            if (strcmp(validationLayer, availableLayer.layerName) == 0)
+            if (format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB)
             {
-                hasLayer = true;
-                break;
+                ImageWriter::swizzleBgraToRgba(*pixels);
             }
+            written = ImageWriter::writePng(path, width, height, pixels->data());
+        }
+        else
+        {
+            written = ImageWriter::writeRaw(path, width, height, static_cast<uint32_t>(format), 4, width * 4, pixels->data());
         }
 
-        if (!hasLayer)
-            return false;
+        if (written)
+            mFramesCaptured++;
+        else
+            mCaptureFailures++;
+        mPendingCaptures--;
+    });
+}
+
+void VulkanRenderer::destroyColourImage(OffscreenImage &colourImage)
+{
+    mDispatch.vkDestroyImageView(mMainDevice.logicalDevice, colourImage.imageView, mDispatch.allocator);
+    mDispatch.vkDestroyImage(mMainDevice.logicalDevice, colourImage.image, mDispatch.allocator);
+    mAllocator.free(colourImage.allocation);
+    colourImage = {};
+}
+
+VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
+{
+    VkImageViewCreateInfo viewCreateInfo = {};
+    viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewCreateInfo.image = image;                                       // Image to create view for
+    viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;                    // Type of image (1D, 2D, 3D, Cube, etc)
+    viewCreateInfo.format = format;                                     // Format of image data
+    viewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;        // Allows remapping of rgba components to other rgba values
+    viewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+    // Subresources allow the view to view only a part of an image
+    viewCreateInfo.subresourceRange.aspectMask = aspectFlags;           // Which aspect of image to view (e.g. COLOR_BIT for viewing colour)
+    viewCreateInfo.subresourceRange.baseMipLevel = 0;                   // Start mipmap level to view from
+    viewCreateInfo.subresourceRange.levelCount = 1;                     // Number of mipmap levels to view
+    viewCreateInfo.subresourceRange.baseArrayLayer = 0;                 // Start array level to view from
+    viewCreateInfo.subresourceRange.layerCount = 1;                     // Number of array levels to view
+
+    // Create image view and return it
+    VkImageView imageView;
+    VkResult result = mDispatch.vkCreateImageView(mMainDevice.logicalDevice, &viewCreateInfo, mDispatch.allocator, &imageView);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create an Image View!");
     }
 
-    return true;
+    return imageView;
 }
 
-bool VulkanRenderer::checkDeviceSuitable(VkPhysicalDevice device)
+DeviceScore VulkanRenderer::scoreDevice(VkPhysicalDevice device)
 {
-    /*
+    DeviceScore score;
+    score.device = device;
+
     // Information about the device itself (ID, name, type, vendor, etc)
     VkPhysicalDeviceProperties deviceProperties;
     vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    score.name = deviceProperties.deviceName;
+
+    // -- TYPE --
+    // Software rasterizers and integrated GPUs should only win if nothing better is available
+    switch (deviceProperties.deviceType)
+    {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        score.typeScore = 1000;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        score.typeScore = 500;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        score.typeScore = 250;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        score.typeScore = 50;
+        break;
+    default:
+        score.typeScore = 0;
+        break;
+    }
+
+    // -- MEMORY --
+    // 25 points per GiB of the largest device local heap, capped so memory can't outweigh device type
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+    VkDeviceSize largestHeap = 0;
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+    {
+        if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+        {
+            largestHeap = std::max(largestHeap, memoryProperties.memoryHeaps[i].size);
+        }
+    }
+    score.memoryScore = static_cast<int>(std::min<VkDeviceSize>(largestHeap / (1024 * 1024 * 1024) * 25, 400));
+
+    // -- QUEUES --
+    QueueFamilyIndices indices = getQueueFamilies(device);
+    score.queueScore = (indices.hasDedicatedCompute() ? 50 : 0) + (indices.hasDedicatedTransfer() ? 50 : 0)
+                       + (indices.graphicsFamily == indices.presentationFamily ? 25 : 0);
 
+    // -- FEATURES --
     // Information about what the device can do (geo shader, tess shader, wide lines, etc)
     VkPhysicalDeviceFeatures deviceFeatures;
     vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
-    */
+    const VkBool32 optionalFeatures[] = {
+        deviceFeatures.samplerAnisotropy,
+        deviceFeatures.multiDrawIndirect,
+        deviceFeatures.drawIndirectFirstInstance,
+        deviceFeatures.fillModeNonSolid,
+        deviceFeatures.shaderInt64,
+        deviceFeatures.shaderInt16,
+        deviceFeatures.textureCompressionBC,
+        deviceFeatures.pipelineStatisticsQuery
+    };
+    for (VkBool32 feature : optionalFeatures)
+    {
+        score.featureScore += feature ? 10 : 0;
+    }
+
+    // -- LIMITS --
+    const VkPhysicalDeviceLimits &limits = deviceProperties.limits;
+    score.limitScore = static_cast<int>(limits.maxImageDimension2D / 1024)                      // 16 for 16k textures
+                       + static_cast<int>(std::min(limits.maxPushConstantsSize / 32, 8u))        // 4 for the guaranteed 128 bytes
+                       + static_cast<int>(std::min(limits.maxBoundDescriptorSets, 32u))
+                       + (limits.timestampComputeAndGraphics ? 10 : 0);
+
+    return score;
+}
+
+double VulkanRenderer::benchmarkDevice(VkPhysicalDevice device)
+{
+    // Fill a buffer several times on a throwaway logical device, and time it as a rough measure of device throughput
+    const VkDeviceSize bufferSize = 64 * 1024 * 1024;
+    const uint32_t fillCount = 8;
 
     QueueFamilyIndices indices = getQueueFamilies(device);
 
-    bool extensionsSupported = checkDeviceExtensionSupport(device);
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo queueCreateInfo = {};
+    queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueCreateInfo.queueFamilyIndex = indices.graphicsFamily;
+    queueCreateInfo.queueCount = 1;
+    queueCreateInfo.pQueuePriorities = &priority;
+
+    VkDeviceCreateInfo deviceCreateInfo = {};
+    deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceCreateInfo.queueCreateInfoCount = 1;
+    deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+
+    VkDevice benchDevice;
+    if (vkCreateDevice(device, &deviceCreateInfo, mHostCallbacks, &benchDevice) != VK_SUCCESS)
+        return 0.0;
+
+    DeviceDispatch benchDispatch;
+    benchDispatch.load(benchDevice);
+    benchDispatch.allocator = mHostCallbacks;
+
+    VkQueue queue;
+    benchDispatch.vkGetDeviceQueue(benchDevice, indices.graphicsFamily, 0, &queue);
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    double gigabytesPerSecond = 0.0;
+
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = bufferSize;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkCommandPoolCreateInfo poolCreateInfo = {};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCreateInfo.queueFamilyIndex = indices.graphicsFamily;
+
+    VkFenceCreateInfo fenceCreateInfo = {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    try
+    {
+        if (benchDispatch.vkCreateBuffer(benchDevice, &bufferCreateInfo, benchDispatch.allocator, &buffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create benchmark buffer!");
+
+        VkMemoryRequirements memoryRequirements;
+        benchDispatch.vkGetBufferMemoryRequirements(benchDevice, buffer, &memoryRequirements);
+
+        VkMemoryAllocateInfo memoryAllocInfo = {};
+        memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        memoryAllocInfo.allocationSize = memoryRequirements.size;
+        memoryAllocInfo.memoryTypeIndex = findMemoryTypeIndex(device, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if (benchDispatch.vkAllocateMemory(benchDevice, &memoryAllocInfo, benchDispatch.allocator, &memory) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate benchmark memory!");
+        benchDispatch.vkBindBufferMemory(benchDevice, buffer, memory, 0);
+
+        if (benchDispatch.vkCreateCommandPool(benchDevice, &poolCreateInfo, benchDispatch.allocator, &commandPool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create benchmark command pool!");
+
+        VkCommandBufferAllocateInfo commandBufferAllocInfo = {};
+        commandBufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        commandBufferAllocInfo.commandPool = commandPool;
+        commandBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        commandBufferAllocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        benchDispatch.vkAllocateCommandBuffers(benchDevice, &commandBufferAllocInfo, &commandBuffer);
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        benchDispatch.vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        for (uint32_t i = 0; i < fillCount; i++)
+        {
+            benchDispatch.vkCmdFillBuffer(commandBuffer, buffer, 0, VK_WHOLE_SIZE, i);
+        }
+        benchDispatch.vkEndCommandBuffer(commandBuffer);
 
-    bool swapChainValid = false;
-    if (extensionsSupported)
+        if (benchDispatch.vkCreateFence(benchDevice, &fenceCreateInfo, benchDispatch.allocator, &fence) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create benchmark fence!");
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        if (benchDispatch.vkQueueSubmit(queue, 1, &submitInfo, fence) == VK_SUCCESS
+            && benchDispatch.vkWaitForFences(benchDevice, 1, &fence, VK_TRUE, UINT64_MAX) == VK_SUCCESS)
+        {
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+            gigabytesPerSecond = (double)(bufferSize * fillCount) / elapsed.count() / 1e9;
+        }
+    } catch (const std::runtime_error &e)
     {
-        SwapChainDetails swapChainDetails = getSwapChainDetails(device);
-        swapChainValid = !swapChainDetails.presentationModes.empty() && !swapChainDetails.formats.empty();
+        printf("Benchmark skipped: %s\n", e.what());
     }
-    return indices.isValid() && extensionsSupported && swapChainValid;
+
+    benchDispatch.vkDestroyFence(benchDevice, fence, benchDispatch.allocator);
+    benchDispatch.vkDestroyCommandPool(benchDevice, commandPool, benchDispatch.allocator);
+    benchDispatch.vkDestroyBuffer(benchDevice, buffer, benchDispatch.allocator);
+    benchDispatch.vkFreeMemory(benchDevice, memory, benchDispatch.allocator);
+    benchDispatch.vkDestroyDevice(benchDevice, benchDispatch.allocator);
+
+    return gigabytesPerSecond;
 }
 
 QueueFamilyIndices VulkanRenderer::getQueueFamilies(VkPhysicalDevice device)
@@ -368,35 +2551,82 @@ QueueFamilyIndices VulkanRenderer::getQueueFamilies(VkPhysicalDevice device)
     std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilyList.data());
 
-    // Go through each queue family and check if it has at least 1 of the requires types of queue
+    // Go through every queue family (not just until graphics and presentation are found), so dedicated families are discovered too
+    bool graphicsCanPresent = false;
+    int anyComputeFamily = -1;
     int i = 0;
     for (const auto &queueFamily : queueFamilyList)
     {
         // First check if queue family has at least 1 queue in that family (could have no queues)
-        // Queue can be multiple types defined through bitfield. Need to bitwise AND with VK_QUEUE_*_BIT to check if has required type
-        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        if (queueFamily.queueCount == 0)
         {
-            indices.graphicsFamily = i; // If queue family is valid, then get index
+            i++;
+            continue;
         }
 
-        // Check if Queue Family supports presentation
+        // Queue can be multiple types defined through bitfield. Need to bitwise AND with VK_QUEUE_*_BIT to check if has required type
+        bool hasGraphics = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+        bool hasCompute = queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT;
+        bool hasTransfer = queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT;
+
+        // Check if Queue Family supports presentation (never, if there is no surface)
         VkBool32 presentationSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, mSurface, &presentationSupport);
+        if (mSurface != VK_NULL_HANDLE)
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, mSurface, &presentationSupport);
+        }
+
+        // Prefer a graphics family that can also present, so one queue can do both
+        if (hasGraphics && (indices.graphicsFamily < 0 || (presentationSupport && !graphicsCanPresent)))
+        {
+            indices.graphicsFamily = i;
+            graphicsCanPresent = presentationSupport;
+        }
+
         // Check if queue is presentation type (can be both graphics and presentation)
-        if (queueFamily.queueCount > 0 && presentationSupport)
+        if (presentationSupport && indices.presentationFamily < 0)
         {
             indices.presentationFamily = i;
         }
 
-        // Check if queue family indices are in a valid state, stop searching if so
-        if (indices.isValid())
+        // Compute without graphics runs asynchronously to graphics work
+        if (hasCompute && anyComputeFamily < 0)
+        {
+            anyComputeFamily = i;
+        }
+        if (hasCompute && !hasGraphics && indices.computeFamily < 0)
+        {
+            indices.computeFamily = i;
+        }
+
+        // Transfer-only families are usually backed by DMA engines
+        if (hasTransfer && !hasGraphics && !hasCompute && indices.transferFamily < 0)
         {
-            break;
+            indices.transferFamily = i;
         }
 
         i++;
     }
 
+    // Present from the graphics queue where possible
+    if (graphicsCanPresent)
+    {
+        indices.presentationFamily = indices.graphicsFamily;
+    }
+
+    // No dedicated compute family, so fall back to the graphics family (or any family with compute)
+    if (indices.computeFamily < 0)
+    {
+        bool graphicsHasCompute = indices.graphicsFamily >= 0 && (queueFamilyList[indices.graphicsFamily].queueFlags & VK_QUEUE_COMPUTE_BIT);
+        indices.computeFamily = graphicsHasCompute ? indices.graphicsFamily : anyComputeFamily;
+    }
+
+    // No dedicated transfer family, so use the async compute family if there is one, otherwise graphics (both can always transfer)
+    if (indices.transferFamily < 0)
+    {
+        indices.transferFamily = indices.hasDedicatedCompute() ? indices.computeFamily : indices.graphicsFamily;
+    }
+
     return indices;
 }
 
@@ -432,3 +2662,247 @@ SwapChainDetails VulkanRenderer::getSwapChainDetails(VkPhysicalDevice device)
 
     return swapChainDetails;
 }
+
+VkSurfaceFormatKHR VulkanRenderer::chooseBestSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &formats)
+{
+    // If only 1 format available and is undefined, then this means ALL formats are available (no restrictions)
+    if (formats.size() == 1 && formats[0].format == VK_FORMAT_UNDEFINED)
+    {
+        return { VK_FORMAT_R8G8B8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+    }
+
+    // If restricted, search for optimal format
+    for (const auto &format : formats)
+    {
+        if ((format.format == VK_FORMAT_R8G8B8A8_UNORM || format.format == VK_FORMAT_B8G8R8A8_UNORM)
+            && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
+        {
+            return format;
+        }
+    }
+
+    // If can't find optimal format, then just return first format
+    return formats[0];
+}
+
+VkPresentModeKHR VulkanRenderer::chooseBestPresentationMode(const std::vector<VkPresentModeKHR> &presentationModes)
+{
+    // Modes to try for the chosen policy, best first (FIFO always has to be supported, so is the final fallback)
+    std::vector<VkPresentModeKHR> preferredModes;
+    switch (mConfig.presentPolicy)
+    {
+    case PresentPolicy::Immediate:
+        preferredModes = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+        break;
+    case PresentPolicy::Mailbox:
+        preferredModes = { VK_PRESENT_MODE_MAILBOX_KHR };
+        break;
+    case PresentPolicy::FifoRelaxed:
+        preferredModes = { VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+        break;
+    case PresentPolicy::Fifo:
+        break;
+    }
+
+    for (VkPresentModeKHR preferredMode : preferredModes)
+    {
+        if (std::find(presentationModes.begin(), presentationModes.end(), preferredMode) != presentationModes.end())
+        {
+            return preferredMode;
+        }
+    }
+
+    // If can't find preferred mode, use FIFO as Vulkan spec says it must be present
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+void VulkanRenderer::recreateSwapchain()
+{
+    // Old swapchain is retired rather than waited on, the device keeps running
+    createSwapchain();
+    mSwapchainOutOfDate = false;
+    mSwapchainGeneration++;
+}
+
+VkFence VulkanRenderer::getPresentFence()
+{
+    // Recycle fences of presents that have finished, so the list doesn't grow while the swapchain lives
+    for (size_t i = 0; i < mPresentFences.size();)
+    {
+        if (mDispatch.vkGetFenceStatus(mMainDevice.logicalDevice, mPresentFences[i]) == VK_SUCCESS)
+        {
+            mDispatch.vkResetFences(mMainDevice.logicalDevice, 1, &mPresentFences[i]);
+            mFreePresentFences.push_back(mPresentFences[i]);
+            mPresentFences[i] = mPresentFences.back();
+            mPresentFences.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    if (!mFreePresentFences.empty())
+    {
+        VkFence fence = mFreePresentFences.back();
+        mFreePresentFences.pop_back();
+        return fence;
+    }
+
+    VkFenceCreateInfo fenceCreateInfo = {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence;
+    if (mDispatch.vkCreateFence(mMainDevice.logicalDevice, &fenceCreateInfo, mDispatch.allocator, &fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Fence!");
+    }
+    return fence;
+}
+
+void VulkanRenderer::collectRetiredSwapchains(bool presented)
+{
+    if (mRetiredSwapchains.empty())
+        return;
+
+    if (mEnabledFeatures.swapchainMaintenance1)
+    {
+        // A retired swapchain can go once the fences of all its presents have signalled (this also covers the
+        // rendering, as each present waited on it)
+        for (size_t i = 0; i < mRetiredSwapchains.size();)
+        {
+            bool finished = true;
+            for (VkFence fence : mRetiredSwapchains[i].presentFences)
+            {
+                if (mDispatch.vkGetFenceStatus(mMainDevice.logicalDevice, fence) != VK_SUCCESS)
+                {
+                    finished = false;
+                    break;
+                }
+            }
+
+            if (finished)
+            {
+                destroyRetiredSwapchain(mRetiredSwapchains[i]);
+                mRetiredSwapchains.erase(mRetiredSwapchains.begin() + i);
+            }
+            else
+            {
+                i++;
+            }
+        }
+        return;
+    }
+
+    // Without present fences nothing says when a present is done, and idling the (usually shared) queue would stall the frame.
+    // Once the new swapchain has presented successfully the old one has been handed over, and its last presents were queued
+    // before this frame. So it's kept until this frame and a full ring of frames after it have finished on the GPU
+    uint64_t framesCompleted = getFramesCompleted();
+    for (size_t i = 0; i < mRetiredSwapchains.size();)
+    {
+        RetiredSwapchain &retired = mRetiredSwapchains[i];
+        if (presented && retired.releaseFrame == 0)
+        {
+            retired.releaseFrame = mFrameNumber + 1 + mFrames.size();
+        }
+
+        if (retired.releaseFrame != 0 && framesCompleted >= retired.releaseFrame)
+        {
+            destroyRetiredSwapchain(retired);
+            mRetiredSwapchains.erase(mRetiredSwapchains.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+void VulkanRenderer::destroyRetiredSwapchain(RetiredSwapchain &retired)
+{
+    mLatencyLimiter.swapchainDestroyed(retired.swapchain);
+    for (VkFence fence : retired.presentFences)
+    {
+        mDispatch.vkResetFences(mMainDevice.logicalDevice, 1, &fence);
+        mFreePresentFences.push_back(fence);
+    }
+    for (const auto &image : retired.images)
+    {
+        mDispatch.vkDestroySemaphore(mMainDevice.logicalDevice, image.renderFinished, mDispatch.allocator);
+        mDispatch.vkDestroyImageView(mMainDevice.logicalDevice, image.imageView, mDispatch.allocator);
+    }
+    mDispatch.vkDestroySwapchainKHR(mMainDevice.logicalDevice, retired.swapchain, mDispatch.allocator);
+}
+
+void VulkanRenderer::deferDestroy(std::function<void()> destroy)
+{
+    // Frames up to and including the one being recorded may use it, so it goes once all of them are done
+    mDeletionQueue.push(mFrameNumber.load() + 1, std::move(destroy));
+}
+
+uint64_t VulkanRenderer::getFramesCompleted() const
+{
+    // Frames are submitted to one queue and finish in order, so once the oldest frame context in the ring has
+    // been waited on, every frame numbered before it has finished too
+    uint64_t framesInFlight = mFrames.size();
+    return mFrameNumber >= framesInFlight ? mFrameNumber - framesInFlight + 1 : 0;
+}
+
+void VulkanRenderer::updateFramebufferSize()
+{
+    // GLFW only allows this on the main thread
+    if (mWindow == nullptr)
+        return;
+
+    int width, height;
+    glfwGetFramebufferSize(mWindow, &width, &height);
+    mFramebufferExtent.width = static_cast<uint32_t>(width);
+    mFramebufferExtent.height = static_cast<uint32_t>(height);
+}
+
+VkExtent2D VulkanRenderer::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &surfaceCapabilities)
+{
+    // If current extent is at numeric limits, then extent can vary. Otherwise, it is the size of the window.
+    if (surfaceCapabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
+    {
+        return surfaceCapabilities.currentExtent;
+    }
+
+    // If value can vary, need to set manually (from the window, or from config for a headless surface)
+    // Window size is read on the main thread beforehand, as this can run on a start up worker
+    VkExtent2D newExtent = { mConfig.offscreenWidth, mConfig.offscreenHeight };
+    if (mWindow != nullptr)
+    {
+        newExtent = mFramebufferExtent;
+    }
+
+    // Surface also defines max and min, so make sure within boundaries by clamping value
+    newExtent.width = std::max(surfaceCapabilities.minImageExtent.width, std::min(surfaceCapabilities.maxImageExtent.width, newExtent.width));
+    newExtent.height = std::max(surfaceCapabilities.minImageExtent.height, std::min(surfaceCapabilities.maxImageExtent.height, newExtent.height));
+
+    return newExtent;
+}
+
+uint32_t VulkanRenderer::chooseSwapchainImageCount(const VkSurfaceCapabilitiesKHR &surfaceCapabilities, VkPresentModeKHR presentMode)
+{
+    // Mailbox needs an image being shown, one queued and one to draw to, or it blocks like FIFO
+    uint32_t imageCount = surfaceCapabilities.minImageCount;
+    if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+    {
+        imageCount = std::max(imageCount, 3u);
+    }
+
+    // An extra image lets the next frame start without waiting for presentation, at the cost of a frame of queueing
+    if (mConfig.swapchainTarget == SwapchainTarget::Throughput)
+    {
+        imageCount++;
+    }
+
+    // If maxImageCount is 0, then limitless
+    if (surfaceCapabilities.maxImageCount > 0)
+    {
+        imageCount = std::min(imageCount, surfaceCapabilities.maxImageCount);
+    }
+
+    return imageCount;
+}
@@ -6,34 +6,186 @@
 #include <stdexcept>
 #include <vector>
 #include <set>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cmath>
 
 #include "VulkanValidation.hpp"
 #include "Utilities.hpp"
+#include "RendererConfig.hpp"
+#include "TraceRecorder.hpp"
+#include "TaskGraph.hpp"
+#include "ThreadPool.hpp"
+#include "FeatureChain.hpp"
+#include "DeviceDispatch.hpp"
+#include "DeletionQueue.hpp"
+#include "LatencyLimiter.hpp"
+#include "ResolutionController.hpp"
+#include "ImageWriter.hpp"
+#include "GpuAllocator.hpp"
+#include "GeometryBuffer.hpp"
+#include "HostAllocator.hpp"
+#include "MappedFile.hpp"
+#include "ResidencyManager.hpp"
+#include "ResourcePool.hpp"
+#include "StagingManager.hpp"
+#include "TextureUploader.hpp"
 
 class VulkanRenderer
 {
 public:
     VulkanRenderer();
 
-    int init(GLFWwindow* newWindow);
+    int init(GLFWwindow* newWindow, const RendererConfig& config = RendererConfig());
+    // Window is created by createWindow on the calling thread, while the rest of start up runs alongside it (no window if headless)
+    int init(const std::function<GLFWwindow*()>& createWindow, const RendererConfig& config = RendererConfig());
+
+    // Call before sampling input for the next frame, paces the frame start to keep latency low
+    void beginFrame();
+    // Returns false if nothing was drawn (window minimised, or the surface is still changing size)
+    bool draw();
     void cleanup();
 
+    // Window framebuffer changed size, swapchain is recreated before the next frame
+    void notifyFramebufferResized();
+
+    // On demand rendering: mark the scene dirty (safe from any thread, wakes a waiting main loop)
+    void requestRedraw();
+    // Keep drawing every frame while something is animating
+    void setAnimating(bool animating);
+    // True if a frame should be drawn now, the request is only cleared by a draw that submits a frame
+    bool needsRedraw() const;
+
+    TraceRecorder& getTrace();
+    // Buffer and image uploads from any thread, submitted on the transfer queue each frame
+    StagingManager& getStagingManager();
+    // Streaming resources register here to be evicted when device memory runs short
+    ResidencyManager& getResidencyManager();
+    // Frame being recorded, the frame number resources are added and touched with (any thread)
+    uint64_t getFrameNumber() const;
+    // Texture data into images, on the host with VK_EXT_host_image_copy where supported, otherwise staged
+    TextureUploader& getTextureUploader();
+    // Destroy something the frames in flight may still be using once they have finished, without stalling (any thread)
+    void deferDestroy(std::function<void()> destroy);
+    const DeviceFeatures& getEnabledFeatures() const;
+    RendererStats getStats() const;
+
     ~VulkanRenderer();
 
 private:
     GLFWwindow* mWindow;
+    RendererConfig mConfig;
+    bool mValidationEnabled = false;
+    DebugLogger mDebugLogger;
+    PerformanceWarningCounter mPerformanceWarnings;
+    DebugCallbackContext mDebugCallbackContext = { &mDebugLogger, &mPerformanceWarnings };
+    TraceRecorder mTrace;
+    HostAllocator mHostAllocator;                           // Outlives every Vulkan object created with its callbacks
+    const VkAllocationCallbacks* mHostCallbacks = nullptr;  // pAllocator for every create/destroy (nullptr when disabled)
+    std::unique_ptr<ThreadPool> mWorkers;
 
     // Vulkan Components
     VkInstance mInstance;
+    InstanceDispatch mInstanceDispatch;
+    uint32_t mInstanceApiVersion = VK_API_VERSION_1_0;
     VkDebugUtilsMessengerEXT callback;
     struct
     {
         VkPhysicalDevice physicalDevice;
         VkDevice logicalDevice;
     } mMainDevice;
+    DeviceDispatch mDispatch;       // Every device level call goes through this
+    GpuAllocator mAllocator;        // Every buffer and image gets its memory from this
+    StagingManager mStaging;
+    TextureUploader mTextureUploader;
+    ResidencyManager mResidency;    // Evicts streaming resources when a heap nears its budget
+    ResourcePool mResourcePool;     // Transient render targets and buffers, recycled rather than recreated
+    QueueFamilyIndices mQueueFamilyIndices;
     VkQueue mGraphicsQueue;
     VkQueue mPresentationQueue;
-    VkSurfaceKHR mSurface;
+    VkQueue mComputeQueue;
+    VkQueue mTransferQueue;
+    DeviceFeatures mEnabledFeatures;
+    std::vector<const char*> mEnabledDeviceExtensions;
+    VkSurfaceKHR mSurface = VK_NULL_HANDLE;
+    VkSwapchainKHR mSwapchain = VK_NULL_HANDLE;
+    std::vector<SwapchainImage> mSwapchainImages;
+
+    // - Utility
+    VkFormat mSwapchainImageFormat;
+    VkExtent2D mSwapchainExtent;
+    VkPresentModeKHR mPresentMode;
+
+    // - Resizing
+    bool mSwapchainOutOfDate = false;                       // Swapchain no longer matches the surface, recreate before next acquire
+    uint32_t mSwapchainGeneration = 0;                      // Bumped on every recreation, size-dependent targets rebuild when it changes
+    VkExtent2D mFramebufferExtent = {};                     // Window size, read on the main thread (start up, then each draw)
+    bool mSurfaceMaintenanceSupported = false;              // Instance has VK_EXT_surface_maintenance1, needed for swapchain maintenance1
+    std::vector<RetiredSwapchain> mRetiredSwapchains;       // Replaced swapchains whose presents may still be using them
+    std::vector<VkFence> mPresentFences;                    // Fences of presents to the current swapchain
+    std::vector<VkFence> mFreePresentFences;                // Signalled present fences, reset and ready to reuse
+
+    // - On Demand
+    std::atomic<bool> mRedrawRequested{ true };             // First frame is always drawn
+    std::atomic<bool> mAnimating{ false };                  // Set from input callbacks, read by the render loop
+
+    // - Frames
+    std::vector<FrameContext> mFrames;
+    uint32_t mFrameIndex = 0;           // Which frame context is being recorded
+    DeletionQueue mDeletionQueue;       // Keyed by frame number, collected as frames complete
+    std::atomic<uint64_t> mFrameNumber{ 0 }; // Frames submitted so far, advanced on the render thread and read from any
+    bool mSwapchainSupportsTransfer = false;
+    LatencyLimiter mLatencyLimiter;
+
+    // - Capture
+    bool mSwapchainSupportsReadback = false;
+    std::atomic<uint64_t> mFramesCaptured{ 0 };
+    std::atomic<uint64_t> mCaptureFailures{ 0 };
+    std::atomic<uint32_t> mPendingCaptures{ 0 };            // Submitted to the workers and not yet written
+
+    // - Dynamic Resolution
+    ResourcePool::Image mSceneTarget;           // Scene is drawn into the top left of this, then scaled up to the output
+    VkExtent2D mSceneTargetExtent = {};         // Allocated size (output size at the maximum scale)
+    VkExtent2D mSceneExtent = {};               // Size drawn this frame
+    VkFormat mSceneFormat = VK_FORMAT_UNDEFINED;
+    VkFilter mSceneBlitFilter = VK_FILTER_NEAREST;
+    uint32_t mSceneTargetGeneration = std::numeric_limits<uint32_t>::max();
+    bool mSceneBlitSupported = false;
+    ResolutionController mResolution;
+    VkQueryPool mTimestampQueryPool = VK_NULL_HANDLE;
+    double mTimestampPeriod = 0.0;              // Nanoseconds per timestamp tick, 0 if timestamps aren't supported
+    uint64_t mTimestampMask = 0;
+
+    // - Geometry
+    static constexpr uint32_t GeometryGridSize = 8;        // Instances drawn per side of the grid
+    GeometryBuffer mGeometry;                               // Static vertices and indices, pulled by the vertex shader
+    VkShaderModule mGeometryVertexShader = VK_NULL_HANDLE;
+    VkShaderModule mGeometryFragmentShader = VK_NULL_HANDLE;
+    VkPipelineLayout mGeometryPipelineLayout = VK_NULL_HANDLE;  // Push constants only, no descriptor sets
+    VkPipeline mGeometryPipeline = VK_NULL_HANDLE;
+    VkFormat mGeometryPipelineFormat = VK_FORMAT_UNDEFINED;     // Colour format the pipeline was built for
+    VkDeviceAddress mMeshVertices = 0;
+    VkDeviceAddress mMeshIndices = 0;
+    uint32_t mMeshIndexCount = 0;
+    uint64_t mPulledDraws = 0;
+
+    // - Headless
+    bool mHeadlessSurfaceSupported = false;
+    std::vector<OffscreenImage> mOffscreenImages;
+    VkFormat mOffscreenFormat;
+    VkExtent2D mOffscreenExtent;
+
+    // - Startup
+    void writeTrace();
 
     // Vulkan Functions
     // - Create Functions
@@ -42,18 +194,58 @@ private:
     void createDebugCallback();
     void createLogicalDevice();
     void createSurface();
+    void createOffscreenImages();
+    void createSwapchain();
+    void recreateSwapchain();
+    void updateFramebufferSize();
+    VkFence getPresentFence();
+    void collectRetiredSwapchains(bool presented);
+    void destroyRetiredSwapchain(RetiredSwapchain& retired);
+    uint64_t getFramesCompleted() const;
+    void updateSceneTarget(VkExtent2D outputExtent, VkFormat outputFormat);
+    bool supportsSceneBlit(VkFormat format);
+    OffscreenImage createColourImage(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage);
+    void destroyColourImage(OffscreenImage& image);
+    void createReadbackBuffer(ReadbackBuffer& readback, VkDeviceSize size);
+    void destroyReadbackBuffer(ReadbackBuffer& readback);
+    void drainReadback(ReadbackBuffer& readback);
+    void createFrameContexts();
+    void createGeometryPass();
+    void createGeometryPipeline(VkFormat colourFormat);
+    VkShaderModule createShaderModule(const MappedFile& code);
+
+    // - Record Functions
+    bool acquireNextImage(FrameContext& frame, uint32_t& imageIndex);
+    StagingManager::GraphicsWait recordCommands(FrameContext& frame, VkImage targetImage, VkImageLayout finalLayout, VkExtent2D outputExtent, ReadbackBuffer* readback);
+    void recordGeometry(FrameContext& frame, VkCommandBuffer commandBuffer);
+    void readFrameTimestamps(FrameContext& frame);
 
     // - Get Functions
     void getPhysicalDevice();
 
     // - Support Functions
+    void negotiateDeviceFeatures(FeatureChain& enabledFeatures);
+    VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+
     // -- Checker Functions
     bool checkInstanceExtensionsSupport(std::vector<const char*>* checkExtensions);
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
     bool checkValidationLayerSupport();
+    bool checkValidationFeaturesSupport();
     bool checkDeviceSuitable(VkPhysicalDevice device);
 
     // -- Getter Functions
+    std::vector<const char*> getRequiredDeviceExtensions();
+    std::vector<const char*> getOptionalDeviceExtensions();
+    bool isDeviceExtensionEnabled(const char* extensionName);
+    DeviceScore scoreDevice(VkPhysicalDevice device);
+    double benchmarkDevice(VkPhysicalDevice device);
     QueueFamilyIndices getQueueFamilies(VkPhysicalDevice device);
     SwapChainDetails getSwapChainDetails(VkPhysicalDevice device);
+
+    // -- Choose Functions
+    VkSurfaceFormatKHR chooseBestSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& formats);
+    VkPresentModeKHR chooseBestPresentationMode(const std::vector<VkPresentModeKHR>& presentationModes);
+    VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& surfaceCapabilities);
+    uint32_t chooseSwapchainImageCount(const VkSurfaceCapabilitiesKHR& surfaceCapabilities, VkPresentModeKHR presentMode);
 };
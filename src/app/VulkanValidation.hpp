@@ -1,14 +1,50 @@
 #pragma once
 
 #include <vector>
+#include <cstring>
 #include <vulkan/vulkan.h>
 
+#include "DebugLogger.hpp"
+#include "PerformanceWarningCounter.hpp"
+
+// How much validation to run, each tier above Core adds its own checks on top of the core checks
+enum class ValidationLevel
+{
+    Off,                // No layers, no overhead
+    Core,               // Standard validation layer checks
+    Synchronization,    // Core + synchronization validation (missing barriers, hazards)
+    BestPractices,      // Core + best practices (including performance warnings)
+    GpuAssisted         // Core + GPU-assisted validation (out of bounds descriptor/buffer access in shaders)
+};
+
 #ifdef _DEBUG
-const bool validationEnabled = true;
+const ValidationLevel defaultValidationLevel = ValidationLevel::Core;
 #else
-const bool validationEnabled = false;
+const ValidationLevel defaultValidationLevel = ValidationLevel::Off;
 #endif
 
+// Read a validation level by name (off, core, sync, best-practices, gpu), returns false if name isn't recognised
+static bool parseValidationLevel(const char* name, ValidationLevel& level)
+{
+    struct { const char* name; ValidationLevel level; } levels[] = {
+        { "off", ValidationLevel::Off },
+        { "core", ValidationLevel::Core },
+        { "sync", ValidationLevel::Synchronization },
+        { "best-practices", ValidationLevel::BestPractices },
+        { "gpu", ValidationLevel::GpuAssisted }
+    };
+
+    for (const auto& entry : levels)
+    {
+        if (strcmp(name, entry.name) == 0)
+        {
+            level = entry.level;
+            return true;
+        }
+    }
+    return false;
+}
+
 // List of validation layers to use
 // VK_LAYER_LUNARG_standard_validation = All standard validation layers
 const std::vector<const char*> validationLayers =
@@ -16,6 +52,13 @@ const std::vector<const char*> validationLayers =
     "VK_LAYER_KHRONOS_validation"
 };
 
+// Where debug messages go, passed to the callback as pUserData
+struct DebugCallbackContext
+{
+    DebugLogger* logger;                                    // Prints warnings and errors off the driver thread
+    PerformanceWarningCounter* performanceWarnings;         // Counts every performance message, whatever its severity
+};
+
 // Callback function for validation debugging (will be called when validation information record)
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,        // Severity of error
@@ -23,48 +66,24 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,     // Additional data about error
     void* pUserData)
 {
-    // If validation ERROR, then output error and return failure
-    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
-    {
-        printf("VALIDATION ERROR: %s\n", pCallbackData->pMessage);
-        return VK_TRUE;
-    }
+    DebugCallbackContext* context = static_cast<DebugCallbackContext*>(pUserData);
 
-    // If validation WARNING, then output warning and return okay
-    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+    if (messageType & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT)
     {
-        printf("VALIDATION WARNING: %s\n", pCallbackData->pMessage);
-        return VK_FALSE;
+        context->performanceWarnings->record(pCallbackData->messageIdNumber, pCallbackData->pMessageIdName);
     }
 
-    return VK_FALSE;
-}
-
-static VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger)
-{
-    // vkGetInstanceProcAddr returns a function pointer to the requested function in the requested instance
-    // resulting function is cast as a function pointer with the header of "vkCreateDebugUtilsMessengerEXT"
-    auto func = (PFN_vkCreateDebugUtilsMessengerEXT) vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
-
-    // If function was found, execute it with given data and return result, otherwise, return error
-    if (func != nullptr)
-    {
-        return func(instance, pCreateInfo, pAllocator, pDebugMessenger);
-    }
-    else
+    // Info messages are only subscribed to for the performance counts, so don't print them
+    if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
     {
-        return VK_ERROR_EXTENSION_NOT_PRESENT;
+        context->logger->log(messageSeverity, messageType, pCallbackData);
     }
-}
-
-static void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator)
-{
-    // get function pointer to requested function, then cast to function pointer for vkDestroyDebugReportCallbackEXT
-    auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
 
-    // If function found, execute
-    if (func != nullptr)
+    // If validation ERROR, then return failure
+    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
     {
-        func(instance, debugMessenger, pAllocator);
+        return VK_TRUE;
     }
-}
\ No newline at end of file
+
+    return VK_FALSE;
+}
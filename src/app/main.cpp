@@ -4,37 +4,296 @@
 #include <stdexcept>
 #include <vector>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
 
 #include "VulkanRenderer.hpp"
 
 GLFWwindow* window;
 VulkanRenderer vulkanRenderer;
 
-void initWindow(std::string wName = "Test Window", const int width = 800, const int height = 600)
+void onFramebufferResize(GLFWwindow*, int, int)
+{
+    vulkanRenderer.notifyFramebufferResized();
+}
+
+// Anything the user does may change what's on screen
+void onInput(GLFWwindow*)
 {
-    // Initialize GLFW
-    glfwInit();
+    vulkanRenderer.requestRedraw();
+}
+
+void onKey(GLFWwindow* inputWindow, int, int, int, int) { onInput(inputWindow); }
+void onMouseButton(GLFWwindow* inputWindow, int, int, int) { onInput(inputWindow); }
+void onCursorPos(GLFWwindow* inputWindow, double, double) { onInput(inputWindow); }
+void onScroll(GLFWwindow* inputWindow, double, double) { onInput(inputWindow); }
+void onWindowRefresh(GLFWwindow* inputWindow) { onInput(inputWindow); }
 
+void initWindow(std::string wName = "Test Window", const int width = 800, const int height = 600)
+{
     // Set GLFW to NOT work with OpenGL
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
     window = glfwCreateWindow(width, height, wName.c_str(), nullptr, nullptr);
+    glfwSetFramebufferSizeCallback(window, onFramebufferResize);
+    glfwSetKeyCallback(window, onKey);
+    glfwSetMouseButtonCallback(window, onMouseButton);
+    glfwSetCursorPosCallback(window, onCursorPos);
+    glfwSetScrollCallback(window, onScroll);
+    glfwSetWindowRefreshCallback(window, onWindowRefresh);
+}
+
+// Read renderer options from the command line
+RendererConfig parseArguments(int argc, char** argv)
+{
+    RendererConfig config;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+        {
+            config.headless = true;
+        }
+        else if (strcmp(argv[i], "--headless-surface") == 0)
+        {
+            config.headless = true;
+            config.useHeadlessSurface = true;
+        }
+        else if (strcmp(argv[i], "--size") == 0 && i + 2 < argc)
+        {
+            // A 0x0 image can't be created, so anything not positive keeps the default size
+            int width = atoi(argv[++i]);
+            int height = atoi(argv[++i]);
+            if (width > 0 && height > 0)
+            {
+                config.offscreenWidth = static_cast<uint32_t>(width);
+                config.offscreenHeight = static_cast<uint32_t>(height);
+            }
+            else
+            {
+                printf("Invalid size \"%s %s\" (width and height must be greater than 0), using %ux%u\n",
+                       argv[i - 1], argv[i], config.offscreenWidth, config.offscreenHeight);
+            }
+        }
+        else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc)
+        {
+            config.deviceOverride = argv[++i];
+        }
+        else if (strcmp(argv[i], "--device-benchmark") == 0)
+        {
+            config.deviceBenchmark = true;
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            config.tracePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--sequential-startup") == 0)
+        {
+            config.parallelStartup = false;
+        }
+        else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+        {
+            config.framesInFlight = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            config.headlessFrameCount = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--no-vertex-pulling") == 0)
+        {
+            config.vertexPulling = false;
+        }
+        else if (strcmp(argv[i], "--shader-dir") == 0 && i + 1 < argc)
+        {
+            config.shaderDirectory = argv[++i];
+        }
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+        {
+            config.capturePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--capture-format") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "png") == 0)
+                config.captureFormat = CaptureFormat::Png;
+            else if (strcmp(argv[i], "raw") == 0)
+                config.captureFormat = CaptureFormat::Raw;
+            else
+                printf("Unknown capture format \"%s\" (expected png or raw)\n", argv[i]);
+        }
+        else if (strcmp(argv[i], "--capture-every") == 0 && i + 1 < argc)
+        {
+            config.captureInterval = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--no-dynamic-resolution") == 0)
+        {
+            config.dynamicResolution = false;
+        }
+        else if (strcmp(argv[i], "--resolution-scale") == 0 && i + 2 < argc)
+        {
+            config.minResolutionScale = static_cast<float>(atof(argv[++i]));
+            config.maxResolutionScale = static_cast<float>(atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--gpu-budget") == 0 && i + 1 < argc)
+        {
+            config.gpuFrameBudgetMs = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--no-latency-limit") == 0)
+        {
+            config.limitLatency = false;
+        }
+        else if (strcmp(argv[i], "--max-queued-frames") == 0 && i + 1 < argc)
+        {
+            config.maxQueuedFrames = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--on-demand") == 0)
+        {
+            config.loopMode = RenderLoopMode::OnDemand;
+        }
+        else if (strcmp(argv[i], "--continuous") == 0)
+        {
+            config.loopMode = RenderLoopMode::Continuous;
+        }
+        else if (strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc)
+        {
+            if (!parsePresentPolicy(argv[++i], config.presentPolicy))
+            {
+                printf("Unknown present mode \"%s\" (expected fifo, fifo-relaxed, mailbox or immediate)\n", argv[i]);
+            }
+        }
+        else if (strcmp(argv[i], "--throughput") == 0)
+        {
+            config.swapchainTarget = SwapchainTarget::Throughput;
+        }
+        else if (strcmp(argv[i], "--validation") == 0 && i + 1 < argc)
+        {
+            if (!parseValidationLevel(argv[++i], config.validationLevel))
+            {
+                printf("Unknown validation level \"%s\" (expected off, core, sync, best-practices or gpu)\n", argv[i]);
+            }
+        }
+    }
+
+    return config;
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    // Create Window
-    initWindow("Test Window", 800, 600);
+    RendererConfig config = parseArguments(argc, argv);
 
-    // Create Vulkan Renderer Instance
-    if (vulkanRenderer.init(window) == EXIT_FAILURE)
+    if (config.headless)
+    {
+        // No window or GLFW needed, renderer draws into offscreen images
+        window = nullptr;
+        if (vulkanRenderer.init(window, config) == EXIT_FAILURE)
+            return EXIT_FAILURE;
+
+        // Render a fixed number of frames, then report how fast it went
+        auto renderStart = std::chrono::steady_clock::now();
+        try
+        {
+            for (uint32_t i = 0; i < config.headlessFrameCount; i++)
+            {
+                vulkanRenderer.draw();
+            }
+        }
+        catch (const std::runtime_error &e)
+        {
+            printf("ERROR: %s\n", e.what());
+            vulkanRenderer.cleanup();
+            return EXIT_FAILURE;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+
+        RendererStats stats = vulkanRenderer.getStats();
+        printf("Rendered %llu frames (%u in flight) in %.3f s, %.1f fps\n", static_cast<unsigned long long>(stats.framesRendered),
+               stats.framesInFlight, seconds, seconds > 0.0 ? stats.framesRendered / seconds : 0.0);
+        printf("Resolution scale %.2f, GPU frame time %.3f ms\n", stats.resolutionScale, stats.gpuFrameTimeMs);
+        if (stats.vertexPulling)
+        {
+            printf("Vertex pulling: %llu draws, %.1f KB geometry\n", static_cast<unsigned long long>(stats.pulledDraws),
+                   stats.geometryBytes / 1024.0);
+        }
+        for (size_t i = 0; i < stats.memoryHeaps.size(); i++)
+        {
+            const MemoryHeapStats &heap = stats.memoryHeaps[i];
+            printf("Heap %zu%s: %.1f / %.1f MB budget%s\n", i, heap.deviceLocal ? " (device local)" : "",
+                   heap.usage / (1024.0 * 1024.0), heap.budget / (1024.0 * 1024.0), stats.memoryBudgetQueried ? "" : " (estimated)");
+        }
+        for (const HostScopeStats &scope : stats.hostScopes)
+        {
+            printf("Host %s scope: %llu allocations, %.1f KB live, %.1f KB peak\n", scope.scope,
+                   static_cast<unsigned long long>(scope.allocations), scope.bytes / 1024.0, scope.highWater / 1024.0);
+        }
+
+        // Cleanup finishes any captures still being read back or encoded
+        vulkanRenderer.cleanup();
+        if (!config.capturePath.empty())
+        {
+            stats = vulkanRenderer.getStats();
+            printf("Captured %llu frames (%llu failed)\n", static_cast<unsigned long long>(stats.framesCaptured),
+                   static_cast<unsigned long long>(stats.captureFailures));
+        }
+        return 0;
+    }
+
+    // Initialize GLFW (must happen before the renderer asks it for instance extensions)
+    {
+        ScopedTrace trace(vulkanRenderer.getTrace(), "glfwInit");
+        glfwInit();
+    }
+
+    // Create Vulkan Renderer Instance, window is created on this thread while the renderer starts up in the background
+    auto createWindow = []()
+    {
+        initWindow("Test Window", 800, 600);
+        return window;
+    };
+    if (vulkanRenderer.init(createWindow, config) == EXIT_FAILURE)
         return EXIT_FAILURE;
 
     // Loop until closed
-    while (!glfwWindowShouldClose(window))
+    try
     {
-        glfwPollEvents();
+        while (!glfwWindowShouldClose(window))
+        {
+            if (config.loopMode == RenderLoopMode::Continuous)
+            {
+                // Pace first, so the input polled is as fresh as possible when the frame reaches the screen
+                vulkanRenderer.beginFrame();
+                glfwPollEvents();
+                vulkanRenderer.draw();
+                continue;
+            }
+
+            // Block until an event arrives (or requestRedraw posts one), only drawing when something changed
+            if (vulkanRenderer.needsRedraw())
+            {
+                // Nothing drawn (minimised, or mid-resize) leaves the request pending, so wait for the window to change
+                if (vulkanRenderer.draw())
+                {
+                    glfwPollEvents();
+                }
+                else
+                {
+                    glfwWaitEventsTimeout(config.idleWaitTimeout);
+                }
+            }
+            else
+            {
+                glfwWaitEventsTimeout(config.idleWaitTimeout);
+            }
+        }
+    }
+    catch (const std::runtime_error &e)
+    {
+        printf("ERROR: %s\n", e.what());
+        vulkanRenderer.cleanup();
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return EXIT_FAILURE;
     }
 
     vulkanRenderer.cleanup();
@@ -0,0 +1,115 @@
+#include "DebugLogger.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+
+DebugLogger::~DebugLogger()
+{
+    stop();
+}
+
+void DebugLogger::start()
+{
+    if (mRunning.exchange(true))
+        return;
+
+    mThread = std::thread(&DebugLogger::threadLoop, this);
+}
+
+void DebugLogger::stop()
+{
+    if (!mRunning.exchange(false))
+        return;
+
+    mThread.join();
+
+    // Catch anything queued after the thread's last pass
+    drain();
+
+    for (const auto& seen : mSeen)
+    {
+        if (seen.second.count > 1)
+        {
+            printf("VALIDATION: message %d repeated %u times: %s...\n", seen.second.messageId, seen.second.count, seen.second.text);
+        }
+    }
+    mSeen.clear();
+
+    uint64_t droppedCount = mDroppedCount.exchange(0);
+    if (droppedCount > 0)
+    {
+        printf("VALIDATION: %llu messages dropped (logger queue full)\n", (unsigned long long)droppedCount);
+    }
+}
+
+void DebugLogger::log(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type, const VkDebugUtilsMessengerCallbackDataEXT* callbackData)
+{
+    Message message;
+    message.messageId = callbackData->messageIdNumber;
+    message.severity = severity;
+    message.type = type;
+    strncpy(message.text, callbackData->pMessage != nullptr ? callbackData->pMessage : "", sizeof(message.text) - 1);
+    message.text[sizeof(message.text) - 1] = '\0';
+
+    if (!mQueue.tryPush(message))
+    {
+        mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void DebugLogger::threadLoop()
+{
+    while (mRunning.load())
+    {
+        drain();
+
+        // Queue is lock free, so there is nothing to wait on, just check back shortly
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+void DebugLogger::drain()
+{
+    Message message;
+    while (mQueue.tryPop(message))
+    {
+        print(message);
+    }
+}
+
+void DebugLogger::print(const Message& message)
+{
+    // Some messages have no ID, so fall back to the text to tell them apart
+    uint64_t key = message.messageId != 0 ? (uint64_t)(uint32_t)message.messageId
+                                          : ((uint64_t)1 << 32) | (uint32_t)std::hash<std::string>()(message.text);
+
+    auto inserted = mSeen.emplace(key, MessageCount());
+    MessageCount& seen = inserted.first->second;
+    if (!inserted.second)
+    {
+        seen.count++;
+        return;
+    }
+
+    seen.count = 1;
+    seen.messageId = message.messageId;
+    seen.severity = message.severity;
+    strncpy(seen.text, message.text, sizeof(seen.text) - 1);
+    seen.text[sizeof(seen.text) - 1] = '\0';
+
+    if (message.severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+    {
+        printf("VALIDATION ERROR: %s\n", message.text);
+    }
+    else if (message.severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+    {
+        printf("VALIDATION WARNING: %s\n", message.text);
+    }
+    else
+    {
+        printf("VALIDATION INFO: %s\n", message.text);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+
+#include "LockFreeQueue.hpp"
+
+// Prints validation messages on a background thread, so the driver thread that raised them only pays for a copy
+// Repeats of a message (by message ID) are counted instead of printed, and summarised when the logger stops
+class DebugLogger
+{
+public:
+    struct Message
+    {
+        int32_t messageId;
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+        VkDebugUtilsMessageTypeFlagsEXT type;
+        char text[2048];            // Truncated if longer
+    };
+
+    DebugLogger() = default;
+    ~DebugLogger();
+
+    DebugLogger(const DebugLogger&) = delete;
+    DebugLogger& operator=(const DebugLogger&) = delete;
+
+    void start();
+    // Print everything still queued, then the repeat summary
+    void stop();
+
+    // Queue a message from any thread without locking (dropped and counted if the queue is full)
+    void log(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type, const VkDebugUtilsMessengerCallbackDataEXT* callbackData);
+
+private:
+    struct MessageCount
+    {
+        uint32_t count;
+        int32_t messageId;
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+        char text[128];             // Start of the first message, for the summary
+    };
+
+    LockFreeQueue<Message, 512> mQueue;
+    std::thread mThread;
+    std::atomic<bool> mRunning{false};
+    std::atomic<uint64_t> mDroppedCount{0};
+
+    // Only touched by the logger thread (and by stop, after the thread has joined)
+    std::unordered_map<uint64_t, MessageCount> mSeen;
+
+    void threadLoop();
+    void drain();
+    void print(const Message& message);
+};
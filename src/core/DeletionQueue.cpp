@@ -0,0 +1,56 @@
+#include "DeletionQueue.hpp"
+
+#include <algorithm>
+
+void DeletionQueue::push(uint64_t value, Deletion destroy)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.push_back({ value, std::move(destroy) });
+}
+
+void DeletionQueue::collect(uint64_t completedValue)
+{
+    // Taken out under the lock and run outside it, so a deletion can queue further deletions
+    std::vector<Entry> ready;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto firstPending = std::stable_partition(mEntries.begin(), mEntries.end(),
+                                                  [completedValue](const Entry& entry) { return entry.value <= completedValue; });
+        if (firstPending == mEntries.begin())
+            return;
+
+        ready.assign(std::make_move_iterator(mEntries.begin()), std::make_move_iterator(firstPending));
+        mEntries.erase(mEntries.begin(), firstPending);
+    }
+
+    for (auto& entry : ready)
+    {
+        entry.destroy();
+    }
+}
+
+void DeletionQueue::flush()
+{
+    // Deletions may queue more, keep going until nothing is left
+    while (true)
+    {
+        std::vector<Entry> ready;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mEntries.empty())
+                return;
+            ready.swap(mEntries);
+        }
+
+        for (auto& entry : ready)
+        {
+            entry.destroy();
+        }
+    }
+}
+
+size_t DeletionQueue::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.size();
+}
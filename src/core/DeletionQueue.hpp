@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Destroys objects once the GPU work that might still use them has finished, without waiting for the device to idle
+// Each deletion is tagged with a value on a timeline that only moves forward (frame numbers, or a timeline semaphore),
+// and runs when collect is given a completed value at least that high
+// Thread safe, deletions run on the thread calling collect or flush
+class DeletionQueue
+{
+public:
+    using Deletion = std::function<void()>;
+
+    // Run destroy once completedValue reaches value
+    void push(uint64_t value, Deletion destroy);
+
+    // Run every deletion whose value has been reached, in the order they were pushed
+    void collect(uint64_t completedValue);
+
+    // Run everything now (device idle, or shutting down)
+    void flush();
+
+    size_t getPendingCount() const;
+
+private:
+    struct Entry
+    {
+        uint64_t value;
+        Deletion destroy;
+    };
+
+    mutable std::mutex mMutex;
+    std::vector<Entry> mEntries;
+};
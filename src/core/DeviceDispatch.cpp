@@ -0,0 +1,19 @@
+#include "DeviceDispatch.hpp"
+
+void DeviceDispatch::load(VkDevice newDevice)
+{
+    device = newDevice;
+
+#define LV_LOAD_DEVICE_FUNCTION(name) name = (PFN_##name)vkGetDeviceProcAddr(device, #name);
+    LV_DEVICE_FUNCTIONS(LV_LOAD_DEVICE_FUNCTION)
+#undef LV_LOAD_DEVICE_FUNCTION
+}
+
+void InstanceDispatch::load(VkInstance newInstance)
+{
+    instance = newInstance;
+
+#define LV_LOAD_INSTANCE_FUNCTION(name) name = (PFN_##name)vkGetInstanceProcAddr(instance, #name);
+    LV_INSTANCE_FUNCTIONS(LV_LOAD_INSTANCE_FUNCTION)
+#undef LV_LOAD_INSTANCE_FUNCTION
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// Lists of Vulkan entry points, expanded by X(name) to generate the dispatch tables below
+// Functions from versions/extensions the device doesn't have are left as nullptr, so check before using them
+
+// Device level functions, loaded through vkGetDeviceProcAddr so calls go straight to the driver instead of through loader trampolines
+#define LV_DEVICE_FUNCTIONS(X) \
+    /* Device and queues */ \
+    X(vkDestroyDevice) \
+    X(vkGetDeviceQueue) \
+    X(vkDeviceWaitIdle) \
+    X(vkQueueSubmit) \
+    X(vkQueueWaitIdle) \
+    /* Memory */ \
+    X(vkAllocateMemory) \
+    X(vkFreeMemory) \
+    X(vkMapMemory) \
+    X(vkUnmapMemory) \
+    X(vkFlushMappedMemoryRanges) \
+    X(vkInvalidateMappedMemoryRanges) \
+    /* Buffers and images */ \
+    X(vkCreateBuffer) \
+    X(vkDestroyBuffer) \
+    X(vkGetBufferMemoryRequirements) \
+    X(vkGetBufferMemoryRequirements2) \
+    X(vkBindBufferMemory) \
+    X(vkGetBufferDeviceAddress) \
+    X(vkCreateImage) \
+    X(vkDestroyImage) \
+    X(vkGetImageMemoryRequirements) \
+    X(vkGetImageMemoryRequirements2) \
+    X(vkBindImageMemory) \
+    X(vkCreateImageView) \
+    X(vkDestroyImageView) \
+    /* Synchronisation */ \
+    X(vkCreateFence) \
+    X(vkDestroyFence) \
+    X(vkResetFences) \
+    X(vkGetFenceStatus) \
+    X(vkWaitForFences) \
+    X(vkCreateSemaphore) \
+    X(vkDestroySemaphore) \
+    /* Command pools and buffers */ \
+    X(vkCreateCommandPool) \
+    X(vkDestroyCommandPool) \
+    X(vkResetCommandPool) \
+    X(vkAllocateCommandBuffers) \
+    X(vkFreeCommandBuffers) \
+    X(vkBeginCommandBuffer) \
+    X(vkEndCommandBuffer) \
+    /* Pipelines */ \
+    X(vkCreateShaderModule) \
+    X(vkDestroyShaderModule) \
+    X(vkCreatePipelineLayout) \
+    X(vkDestroyPipelineLayout) \
+    X(vkCreateGraphicsPipelines) \
+    X(vkDestroyPipeline) \
+    /* Commands */ \
+    X(vkCmdPipelineBarrier) \
+    X(vkCmdCopyBuffer) \
+    X(vkCmdCopyBufferToImage) \
+    X(vkCmdCopyImageToBuffer) \
+    X(vkCmdBlitImage) \
+    X(vkCmdClearColorImage) \
+    X(vkCmdFillBuffer) \
+    X(vkCmdBeginRendering) \
+    X(vkCmdEndRendering) \
+    X(vkCmdBindPipeline) \
+    X(vkCmdPushConstants) \
+    X(vkCmdSetViewport) \
+    X(vkCmdSetScissor) \
+    X(vkCmdDraw) \
+    /* Queries */ \
+    X(vkCreateQueryPool) \
+    X(vkDestroyQueryPool) \
+    X(vkCmdResetQueryPool) \
+    X(vkCmdWriteTimestamp) \
+    X(vkGetQueryPoolResults) \
+    /* VK_KHR_swapchain */ \
+    X(vkCreateSwapchainKHR) \
+    X(vkDestroySwapchainKHR) \
+    X(vkGetSwapchainImagesKHR) \
+    X(vkAcquireNextImageKHR) \
+    X(vkQueuePresentKHR) \
+    /* VK_KHR_present_wait */ \
+    X(vkWaitForPresentKHR) \
+    /* VK_EXT_host_image_copy */ \
+    X(vkCopyMemoryToImageEXT) \
+    X(vkTransitionImageLayoutEXT)
+
+// Instance level extension functions, looked up once after the instance is created
+#define LV_INSTANCE_FUNCTIONS(X) \
+    /* VK_EXT_debug_utils */ \
+    X(vkCreateDebugUtilsMessengerEXT) \
+    X(vkDestroyDebugUtilsMessengerEXT) \
+    /* VK_EXT_headless_surface */ \
+    X(vkCreateHeadlessSurfaceEXT)
+
+#define LV_DECLARE_FUNCTION(name) PFN_##name name = nullptr;
+
+// Function pointers for one logical device
+struct DeviceDispatch
+{
+    VkDevice device = VK_NULL_HANDLE;
+    const VkAllocationCallbacks* allocator = nullptr;     // Host allocator for every object created on the device
+
+    LV_DEVICE_FUNCTIONS(LV_DECLARE_FUNCTION)
+
+    void load(VkDevice newDevice);
+};
+
+// Extension function pointers for one instance
+struct InstanceDispatch
+{
+    VkInstance instance = VK_NULL_HANDLE;
+
+    LV_INSTANCE_FUNCTIONS(LV_DECLARE_FUNCTION)
+
+    void load(VkInstance newInstance);
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Builds a VkPhysicalDeviceFeatures2 pNext chain out of feature structs, and owns them so their addresses stay valid
+// The same chain is used to query what a device supports (vkGetPhysicalDeviceFeatures2) and to enable features (VkDeviceCreateInfo::pNext)
+class FeatureChain
+{
+public:
+    FeatureChain()
+    {
+        mRoot.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        mTail = &mRoot.pNext;
+    }
+
+    // Chain holds pointers to its own members, so it can't be copied or moved
+    FeatureChain(const FeatureChain&) = delete;
+    FeatureChain& operator=(const FeatureChain&) = delete;
+
+    // Append a zeroed feature struct of the given type to the end of the chain
+    template <typename T>
+    T& add(VkStructureType sType)
+    {
+        auto link = std::make_unique<Link<T>>();
+        T& feature = link->value;
+        feature.sType = sType;
+
+        *mTail = &feature;
+        mTail = &feature.pNext;
+        mLinks.push_back(std::move(link));
+        return feature;
+    }
+
+    // Find a struct that was added to the chain (nullptr if it wasn't)
+    template <typename T>
+    T* find(VkStructureType sType)
+    {
+        for (auto& link : mLinks)
+        {
+            if (link->base()->sType == sType)
+            {
+                return reinterpret_cast<T*>(link->base());
+            }
+        }
+        return nullptr;
+    }
+
+    VkPhysicalDeviceFeatures2& root()
+    {
+        return mRoot;
+    }
+
+private:
+    struct LinkBase
+    {
+        virtual ~LinkBase() = default;
+        virtual VkBaseOutStructure* base() = 0;
+    };
+
+    template <typename T>
+    struct Link : LinkBase
+    {
+        T value = {};
+        VkBaseOutStructure* base() override
+        {
+            return reinterpret_cast<VkBaseOutStructure*>(&value);
+        }
+    };
+
+    VkPhysicalDeviceFeatures2 mRoot = {};
+    void** mTail;
+    std::vector<std::unique_ptr<LinkBase>> mLinks;
+};
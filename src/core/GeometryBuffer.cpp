@@ -0,0 +1,68 @@
+#include "GeometryBuffer.hpp"
+
+#include <stdexcept>
+
+void GeometryBuffer::init(GpuAllocator* allocator, const DeviceDispatch* dispatch, VkDevice device, StagingManager* staging, VkDeviceSize capacity)
+{
+    mAllocator = allocator;
+    mDispatch = dispatch;
+    mDevice = device;
+    mStaging = staging;
+    mCapacity = capacity;
+    mHead = 0;
+
+    // Only ever read through its address (as storage), and written by staging copies
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = capacity;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    mStaging->setBufferSharing(bufferInfo);
+
+    if (mDispatch->vkCreateBuffer(mDevice, &bufferInfo, mDispatch->allocator, &mBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Geometry Buffer!");
+    }
+
+    mAllocation = mAllocator->allocateForBuffer(mBuffer, MemoryUsage::GpuOnly);
+
+    VkBufferDeviceAddressInfo addressInfo = {};
+    addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    addressInfo.buffer = mBuffer;
+    mAddress = mDispatch->vkGetBufferDeviceAddress(mDevice, &addressInfo);
+}
+
+void GeometryBuffer::destroy()
+{
+    if (mBuffer == VK_NULL_HANDLE)
+        return;
+
+    mDispatch->vkDestroyBuffer(mDevice, mBuffer, mDispatch->allocator);
+    mAllocator->free(mAllocation);
+    mBuffer = VK_NULL_HANDLE;
+    mAddress = 0;
+}
+
+GeometryBuffer::Range GeometryBuffer::upload(const void* data, VkDeviceSize size, VkDeviceSize alignment)
+{
+    Range range;
+
+    VkDeviceSize offset = (mHead + alignment - 1) / alignment * alignment;
+    if (mBuffer == VK_NULL_HANDLE || offset + size > mCapacity)
+        return range;
+
+    mHead = offset + size;
+    mStaging->uploadBuffer(mBuffer, offset, data, size);
+
+    range.address = mAddress + offset;
+    range.offset = offset;
+    range.size = size;
+    return range;
+}
+
+GeometryBuffer::Stats GeometryBuffer::getStats() const
+{
+    Stats stats;
+    stats.capacity = mBuffer != VK_NULL_HANDLE ? mCapacity : 0;
+    stats.used = mHead;
+    return stats;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include "DeviceDispatch.hpp"
+#include "GpuAllocator.hpp"
+#include "StagingManager.hpp"
+
+// Device local buffer holding static vertex and index data for every mesh, read by shaders through buffer device addresses
+// Sub-allocated linearly, so a mesh is just an address and a count and drawing it never rebinds vertex or index buffers
+class GeometryBuffer
+{
+public:
+    struct Range
+    {
+        VkDeviceAddress address = 0;    // 0 if the buffer was full
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+    };
+
+    struct Stats
+    {
+        VkDeviceSize capacity = 0;
+        VkDeviceSize used = 0;
+    };
+
+    void init(GpuAllocator* allocator, const DeviceDispatch* dispatch, VkDevice device, StagingManager* staging, VkDeviceSize capacity);
+    void destroy();
+
+    // Copied into staging before returning, usable by graphics submits after the next StagingManager::flush
+    Range upload(const void* data, VkDeviceSize size, VkDeviceSize alignment = 16);
+
+    Stats getStats() const;
+
+private:
+    GpuAllocator* mAllocator = nullptr;
+    const DeviceDispatch* mDispatch = nullptr;
+    VkDevice mDevice = VK_NULL_HANDLE;
+    StagingManager* mStaging = nullptr;
+
+    VkBuffer mBuffer = VK_NULL_HANDLE;
+    GpuAllocation mAllocation;
+    VkDeviceAddress mAddress = 0;
+    VkDeviceSize mCapacity = 0;
+    VkDeviceSize mHead = 0;             // Next free byte
+};
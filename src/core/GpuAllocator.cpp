@@ -0,0 +1,541 @@
+#include "GpuAllocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    VkDeviceSize nextPowerOfTwo(VkDeviceSize value)
+    {
+        VkDeviceSize result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    VkDeviceSize previousPowerOfTwo(VkDeviceSize value)
+    {
+        VkDeviceSize result = 1;
+        while (result * 2 <= value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    uint32_t countBits(VkFlags flags)
+    {
+        uint32_t count = 0;
+        for (; flags != 0; flags &= flags - 1)
+        {
+            count++;
+        }
+        return count;
+    }
+}
+
+GpuAllocator::~GpuAllocator()
+{
+    destroy();
+}
+
+void GpuAllocator::init(const DeviceDispatch* dispatch, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t apiVersion,
+                        bool bufferDeviceAddress, VkDeviceSize preferredBlockSize)
+{
+    mDispatch = dispatch;
+    mDevice = device;
+    mApiVersion = apiVersion;
+    mBufferDeviceAddress = bufferDeviceAddress;
+
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &mMemoryProperties);
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    mBufferImageGranularity = std::max<VkDeviceSize>(1, deviceProperties.limits.bufferImageGranularity);
+    mNonCoherentAtomSize = std::max<VkDeviceSize>(1, deviceProperties.limits.nonCoherentAtomSize);
+
+    // Every node is aligned to its own size, so with a granularity no bigger than the smallest node
+    // linear and optimal resources can never share a granularity page and can live in the same blocks
+    mSeparateKinds = mBufferImageGranularity > MinNodeSize;
+
+    // Small heaps (e.g. the 256MB host visible device local heap) get smaller blocks, so one block can't take most of the heap
+    for (uint32_t i = 0; i < mMemoryProperties.memoryHeapCount; i++)
+    {
+        VkDeviceSize heapLimit = previousPowerOfTwo(std::max<VkDeviceSize>(mMemoryProperties.memoryHeaps[i].size / 8, MinNodeSize));
+        mBlockSizes[i] = std::min(previousPowerOfTwo(preferredBlockSize), heapLimit);
+    }
+
+    mPools.resize(mMemoryProperties.memoryTypeCount * 2);
+}
+
+void GpuAllocator::destroy()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (auto& pool : mPools)
+    {
+        for (auto& block : pool.blocks)
+        {
+            if (block->mapped != nullptr)
+            {
+                mDispatch->vkUnmapMemory(mDevice, block->memory);
+            }
+            mDispatch->vkFreeMemory(mDevice, block->memory, mDispatch->allocator);
+        }
+        pool.blocks.clear();
+    }
+    mPools.clear();
+    mStats = Stats();
+    std::fill(std::begin(mHeapReserved), std::end(mHeapReserved), VkDeviceSize(0));
+}
+
+GpuAllocation GpuAllocator::allocateForImage(VkImage image, MemoryUsage usage, bool dedicated)
+{
+    VkMemoryRequirements requirements;
+    mDispatch->vkGetImageMemoryRequirements(mDevice, image, &requirements);
+
+    // Driver may know an image is faster in its own allocation (e.g. compressed render targets)
+    if (mApiVersion >= VK_API_VERSION_1_1 && mDispatch->vkGetImageMemoryRequirements2 != nullptr)
+    {
+        VkMemoryDedicatedRequirements dedicatedRequirements = {};
+        dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+        VkImageMemoryRequirementsInfo2 requirementsInfo = {};
+        requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+        requirementsInfo.image = image;
+
+        VkMemoryRequirements2 requirements2 = {};
+        requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        requirements2.pNext = &dedicatedRequirements;
+        mDispatch->vkGetImageMemoryRequirements2(mDevice, &requirementsInfo, &requirements2);
+
+        requirements = requirements2.memoryRequirements;
+        dedicated = dedicated || dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+    }
+
+    GpuAllocation allocation = allocateInternal(requirements, usage, ResourceKind::Optimal, dedicated, image, VK_NULL_HANDLE);
+    if (mDispatch->vkBindImageMemory(mDevice, image, allocation.memory, allocation.offset) != VK_SUCCESS)
+    {
+        free(allocation);
+        throw std::runtime_error("Failed to bind Image memory!");
+    }
+    return allocation;
+}
+
+GpuAllocation GpuAllocator::allocateForBuffer(VkBuffer buffer, MemoryUsage usage, bool dedicated)
+{
+    VkMemoryRequirements requirements;
+    mDispatch->vkGetBufferMemoryRequirements(mDevice, buffer, &requirements);
+
+    if (mApiVersion >= VK_API_VERSION_1_1 && mDispatch->vkGetBufferMemoryRequirements2 != nullptr)
+    {
+        VkMemoryDedicatedRequirements dedicatedRequirements = {};
+        dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+        VkBufferMemoryRequirementsInfo2 requirementsInfo = {};
+        requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+        requirementsInfo.buffer = buffer;
+
+        VkMemoryRequirements2 requirements2 = {};
+        requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        requirements2.pNext = &dedicatedRequirements;
+        mDispatch->vkGetBufferMemoryRequirements2(mDevice, &requirementsInfo, &requirements2);
+
+        requirements = requirements2.memoryRequirements;
+        dedicated = dedicated || dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+    }
+
+    GpuAllocation allocation = allocateInternal(requirements, usage, ResourceKind::Linear, dedicated, VK_NULL_HANDLE, buffer);
+    if (mDispatch->vkBindBufferMemory(mDevice, buffer, allocation.memory, allocation.offset) != VK_SUCCESS)
+    {
+        free(allocation);
+        throw std::runtime_error("Failed to bind Buffer memory!");
+    }
+    return allocation;
+}
+
+GpuAllocation GpuAllocator::allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind, bool dedicated)
+{
+    return allocateInternal(requirements, usage, kind, dedicated, VK_NULL_HANDLE, VK_NULL_HANDLE);
+}
+
+GpuAllocation GpuAllocator::allocateInternal(const VkMemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind, bool dedicated,
+                                             VkImage image, VkBuffer buffer)
+{
+    std::vector<uint32_t> memoryTypes = getMemoryTypeOrder(requirements.memoryTypeBits, usage);
+    if (memoryTypes.empty())
+    {
+        throw std::runtime_error("Failed to find a suitable memory type!");
+    }
+
+    // Node must cover the size, and be at least as large as the alignment (nodes are aligned to their size)
+    VkDeviceSize nodeSize = nextPowerOfTwo(std::max({ requirements.size, requirements.alignment, MinNodeSize }));
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // Fall back to the next best memory type if one runs out
+    for (uint32_t memoryType : memoryTypes)
+    {
+        VkDeviceSize blockSize = mBlockSizes[mMemoryProperties.memoryTypes[memoryType].heapIndex];
+
+        GpuAllocation allocation;
+        if (dedicated || nodeSize > blockSize / 2)
+        {
+            allocation = allocateDedicated(requirements, memoryType, image, buffer);
+        }
+        else
+        {
+            allocation = allocateFromPool(nodeSize, memoryType, kind);
+        }
+
+        if (allocation.memory != VK_NULL_HANDLE)
+        {
+            mStats.allocationCount++;
+            mStats.bytesUsed += allocation.size;
+            return allocation;
+        }
+    }
+
+    throw std::runtime_error("Failed to allocate GPU memory!");
+}
+
+GpuAllocation GpuAllocator::allocateDedicated(const VkMemoryRequirements& requirements, uint32_t memoryType, VkImage image, VkBuffer buffer)
+{
+    GpuAllocation allocation;
+
+    // Tell the driver which resource it's for, so it can apply resource specific optimisations
+    VkMemoryDedicatedAllocateInfo dedicatedInfo = {};
+    dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicatedInfo.image = image;
+    dedicatedInfo.buffer = buffer;
+    bool useDedicatedInfo = mApiVersion >= VK_API_VERSION_1_1 && (image != VK_NULL_HANDLE || buffer != VK_NULL_HANDLE);
+
+    if (allocateDeviceMemory(requirements.size, memoryType, useDedicatedInfo ? &dedicatedInfo : nullptr,
+                             allocation.memory, allocation.mapped) != VK_SUCCESS)
+    {
+        return GpuAllocation();
+    }
+
+    allocation.offset = 0;
+    allocation.size = requirements.size;
+    allocation.memoryType = memoryType;
+    allocation.coherent = mMemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    mStats.dedicatedCount++;
+    mStats.bytesReserved += requirements.size;
+    mHeapReserved[getHeapIndex(memoryType)] += requirements.size;
+    return allocation;
+}
+
+GpuAllocation GpuAllocator::allocateFromPool(VkDeviceSize size, uint32_t memoryType, ResourceKind kind)
+{
+    Pool& pool = mPools[memoryType * 2 + (mSeparateKinds && kind == ResourceKind::Optimal ? 1 : 0)];
+
+    // Buddy allocation in a block: take the smallest free node that fits, splitting it in half until it's the right size
+    auto allocateInBlock = [size](GpuMemoryBlock& block, uint32_t& levelOut) -> VkDeviceSize
+    {
+        uint32_t level = 0;
+        while (level + 1 < block.levelCount && block.getNodeSize(level + 1) >= size)
+        {
+            level++;
+        }
+
+        int freeLevel = static_cast<int>(level);
+        while (freeLevel >= 0 && block.freeNodes[freeLevel].empty())
+        {
+            freeLevel--;
+        }
+        if (freeLevel < 0)
+            return VK_WHOLE_SIZE;
+
+        VkDeviceSize offset = *block.freeNodes[freeLevel].begin();
+        block.freeNodes[freeLevel].erase(block.freeNodes[freeLevel].begin());
+
+        // Keep the first half, second half becomes a free buddy
+        for (uint32_t splitLevel = freeLevel + 1; splitLevel <= level; splitLevel++)
+        {
+            block.freeNodes[splitLevel].insert(offset + block.getNodeSize(splitLevel));
+        }
+
+        levelOut = level;
+        block.used += block.getNodeSize(level);
+        return offset;
+    };
+
+    GpuAllocation allocation;
+    allocation.memoryType = memoryType;
+    allocation.coherent = mMemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    for (auto& block : pool.blocks)
+    {
+        uint32_t level;
+        VkDeviceSize offset = allocateInBlock(*block, level);
+        if (offset != VK_WHOLE_SIZE)
+        {
+            allocation.memory = block->memory;
+            allocation.offset = offset;
+            allocation.size = block->getNodeSize(level);
+            allocation.mapped = block->mapped != nullptr ? block->mapped + offset : nullptr;
+            allocation.block = block.get();
+            allocation.level = level;
+            return allocation;
+        }
+    }
+
+    // No room anywhere, start a new block
+    auto block = std::make_unique<GpuMemoryBlock>();
+    block->size = mBlockSizes[mMemoryProperties.memoryTypes[memoryType].heapIndex];
+    block->memoryType = memoryType;
+    if (allocateDeviceMemory(block->size, memoryType, nullptr, block->memory, block->mapped) != VK_SUCCESS)
+    {
+        return GpuAllocation();
+    }
+
+    block->levelCount = 1;
+    while (block->getNodeSize(block->levelCount) >= MinNodeSize)
+    {
+        block->levelCount++;
+    }
+    block->freeNodes.resize(block->levelCount);
+    block->freeNodes[0].insert(0);
+
+    mStats.blockCount++;
+    mStats.bytesReserved += block->size;
+    mHeapReserved[getHeapIndex(memoryType)] += block->size;
+
+    uint32_t level = 0;
+    VkDeviceSize offset = allocateInBlock(*block, level);
+    allocation.memory = block->memory;
+    allocation.offset = offset;
+    allocation.size = block->getNodeSize(level);
+    allocation.mapped = block->mapped != nullptr ? block->mapped + offset : nullptr;
+    allocation.block = block.get();
+    allocation.level = level;
+
+    pool.blocks.push_back(std::move(block));
+    return allocation;
+}
+
+VkResult GpuAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, const void* pNext, VkDeviceMemory& memory, uint8_t*& mapped)
+{
+    // Blocks are shared by every buffer, so any of them may back a buffer with a device address
+    VkMemoryAllocateFlagsInfo allocateFlagsInfo = {};
+    allocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    allocateFlagsInfo.pNext = pNext;
+    allocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+    VkMemoryAllocateInfo memoryAllocInfo = {};
+    memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocInfo.pNext = mBufferDeviceAddress ? &allocateFlagsInfo : pNext;
+    memoryAllocInfo.allocationSize = size;
+    memoryAllocInfo.memoryTypeIndex = memoryType;
+
+    VkResult result = mDispatch->vkAllocateMemory(mDevice, &memoryAllocInfo, mDispatch->allocator, &memory);
+    if (result != VK_SUCCESS)
+    {
+        memory = VK_NULL_HANDLE;
+        return result;
+    }
+    mStats.deviceMemoryCount++;
+
+    // Host visible memory is mapped once for its whole lifetime, mapping per use is slow on some drivers
+    mapped = nullptr;
+    if (mMemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        void* pointer;
+        if (mDispatch->vkMapMemory(mDevice, memory, 0, VK_WHOLE_SIZE, 0, &pointer) == VK_SUCCESS)
+        {
+            mapped = static_cast<uint8_t*>(pointer);
+        }
+    }
+
+    return VK_SUCCESS;
+}
+
+void GpuAllocator::free(GpuAllocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE)
+        return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mStats.allocationCount--;
+    mStats.bytesUsed -= allocation.size;
+
+    GpuMemoryBlock* block = allocation.block;
+    if (block == nullptr)
+    {
+        if (allocation.mapped != nullptr)
+        {
+            mDispatch->vkUnmapMemory(mDevice, allocation.memory);
+        }
+        mDispatch->vkFreeMemory(mDevice, allocation.memory, mDispatch->allocator);
+        mStats.dedicatedCount--;
+        mStats.deviceMemoryCount--;
+        mStats.bytesReserved -= allocation.size;
+        mHeapReserved[getHeapIndex(allocation.memoryType)] -= allocation.size;
+        allocation = GpuAllocation();
+        return;
+    }
+
+    // Merge with the buddy for as long as it's free too
+    VkDeviceSize offset = allocation.offset;
+    uint32_t level = allocation.level;
+    block->used -= block->getNodeSize(level);
+    while (level > 0)
+    {
+        VkDeviceSize buddy = offset ^ block->getNodeSize(level);
+        auto buddyNode = block->freeNodes[level].find(buddy);
+        if (buddyNode == block->freeNodes[level].end())
+            break;
+
+        block->freeNodes[level].erase(buddyNode);
+        offset = std::min(offset, buddy);
+        level--;
+    }
+    block->freeNodes[level].insert(offset);
+
+    // Release empty blocks, keeping one per pool so allocation churn doesn't keep hitting vkAllocateMemory
+    if (block->used == 0)
+    {
+        for (auto& pool : mPools)
+        {
+            auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+                                   [block](const std::unique_ptr<GpuMemoryBlock>& candidate) { return candidate.get() == block; });
+            if (it == pool.blocks.end())
+                continue;
+
+            size_t emptyBlocks = std::count_if(pool.blocks.begin(), pool.blocks.end(),
+                                               [](const std::unique_ptr<GpuMemoryBlock>& candidate) { return candidate->used == 0; });
+            if (emptyBlocks > 1)
+            {
+                if (block->mapped != nullptr)
+                {
+                    mDispatch->vkUnmapMemory(mDevice, block->memory);
+                }
+                mDispatch->vkFreeMemory(mDevice, block->memory, mDispatch->allocator);
+                mStats.blockCount--;
+                mStats.deviceMemoryCount--;
+                mStats.bytesReserved -= block->size;
+                mHeapReserved[getHeapIndex(block->memoryType)] -= block->size;
+                pool.blocks.erase(it);
+            }
+            break;
+        }
+    }
+
+    allocation = GpuAllocation();
+}
+
+VkMappedMemoryRange GpuAllocator::getMappedRange(const GpuAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) const
+{
+    if (size == VK_WHOLE_SIZE)
+    {
+        size = allocation.size - offset;
+    }
+
+    // Range must be aligned to nonCoherentAtomSize, and stay inside the memory object
+    VkDeviceSize memorySize = allocation.block != nullptr ? allocation.block->size : allocation.size;
+    VkDeviceSize start = (allocation.offset + offset) / mNonCoherentAtomSize * mNonCoherentAtomSize;
+    VkDeviceSize end = allocation.offset + offset + size;
+    end = std::min((end + mNonCoherentAtomSize - 1) / mNonCoherentAtomSize * mNonCoherentAtomSize, memorySize);
+
+    VkMappedMemoryRange range = {};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = start;
+    range.size = end == memorySize ? VK_WHOLE_SIZE : end - start;
+    return range;
+}
+
+void GpuAllocator::flush(const GpuAllocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    if (allocation.coherent || allocation.mapped == nullptr)
+        return;
+
+    VkMappedMemoryRange range = getMappedRange(allocation, offset, size);
+    mDispatch->vkFlushMappedMemoryRanges(mDevice, 1, &range);
+}
+
+void GpuAllocator::invalidate(const GpuAllocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    if (allocation.coherent || allocation.mapped == nullptr)
+        return;
+
+    VkMappedMemoryRange range = getMappedRange(allocation, offset, size);
+    mDispatch->vkInvalidateMappedMemoryRanges(mDevice, 1, &range);
+}
+
+std::vector<uint32_t> GpuAllocator::getMemoryTypeOrder(uint32_t allowedTypes, MemoryUsage usage) const
+{
+    // Flags a memory type must have, flags that make it better, and flags that make it worse
+    VkMemoryPropertyFlags required = 0;
+    VkMemoryPropertyFlags preferred = 0;
+    VkMemoryPropertyFlags avoided = 0;
+    switch (usage)
+    {
+    case MemoryUsage::GpuOnly:
+        required = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        avoided = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;          // Leave the small host visible VRAM heap for uploads
+        break;
+    case MemoryUsage::Upload:
+        required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        preferred = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        avoided = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;           // Write combined is faster for write only access
+        break;
+    case MemoryUsage::Readback:
+        required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;         // Uncached reads are very slow
+        break;
+    case MemoryUsage::Staging:
+        required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        avoided = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        break;
+    }
+
+    struct Candidate { uint32_t type; int score; };
+    std::vector<Candidate> candidates;
+    for (uint32_t i = 0; i < mMemoryProperties.memoryTypeCount; i++)
+    {
+        VkMemoryPropertyFlags flags = mMemoryProperties.memoryTypes[i].propertyFlags;
+        if (!(allowedTypes & (1u << i)) || (flags & required) != required)
+            continue;
+
+        int score = static_cast<int>(countBits(flags & preferred)) * 2 - static_cast<int>(countBits(flags & avoided)) * 3;
+        candidates.push_back({ i, score });
+    }
+
+    // Stable, so equally good types keep the driver's order (which lists faster types first)
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+
+    std::vector<uint32_t> order;
+    for (const auto& candidate : candidates)
+    {
+        order.push_back(candidate.type);
+    }
+    return order;
+}
+
+GpuAllocator::Stats GpuAllocator::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+uint32_t GpuAllocator::getHeapIndex(uint32_t memoryType) const
+{
+    return mMemoryProperties.memoryTypes[memoryType].heapIndex;
+}
+
+VkDeviceSize GpuAllocator::getHeapReserved(uint32_t heapIndex) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHeapReserved[heapIndex];
+}
+
+const VkPhysicalDeviceMemoryProperties& GpuAllocator::getMemoryProperties() const
+{
+    return mMemoryProperties;
+}
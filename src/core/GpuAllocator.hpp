@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "DeviceDispatch.hpp"
+
+// What the memory will be used for, decides which memory type it comes from
+enum class MemoryUsage
+{
+    GpuOnly,        // Device local, never touched by the CPU (render targets, static geometry)
+    Upload,         // Written by the CPU every frame and read by the GPU (uniforms, dynamic vertices)
+    Readback,       // Written by the GPU and read by the CPU (captures, queries copied to buffers)
+    Staging         // Written once by the CPU and copied from on the GPU (asset uploads)
+};
+
+// Whether a resource is laid out linearly (buffers, linear images) or opaquely (optimal tiling images)
+// Linear and optimal resources closer together than bufferImageGranularity would alias, so they're kept apart
+enum class ResourceKind
+{
+    Linear,
+    Optimal
+};
+
+// One large piece of device memory, split up by a buddy allocator
+// Level 0 is the whole block, each level below halves the node size
+struct GpuMemoryBlock
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    uint8_t* mapped = nullptr;
+    uint32_t memoryType = 0;
+    uint32_t levelCount = 0;
+    std::vector<std::set<VkDeviceSize>> freeNodes;      // Offsets of free nodes at each level
+    VkDeviceSize used = 0;
+
+    VkDeviceSize getNodeSize(uint32_t level) const
+    {
+        return size >> level;
+    }
+};
+
+// Piece of device memory handed out by GpuAllocator
+struct GpuAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;            // Bind the resource here
+    VkDeviceSize size = 0;              // Size reserved (requested size rounded up to a power of two)
+    uint32_t memoryType = 0;
+    uint8_t* mapped = nullptr;          // Host visible memory stays mapped, already offset to this allocation
+    bool coherent = false;              // Otherwise writes need flush() and reads need invalidate()
+
+    // Owner bookkeeping
+    GpuMemoryBlock* block = nullptr;    // nullptr for dedicated allocations
+    uint32_t level = 0;
+};
+
+// Sub-allocates resources from large blocks of device memory, one set of blocks per memory type (and resource kind)
+// Blocks are split with a buddy allocator: power of two sizes, aligned to their size, merged back with their buddy when freed
+// Resources bigger than half a block, or that the driver wants on their own, get a dedicated allocation
+// Thread safe
+class GpuAllocator
+{
+public:
+    struct Stats
+    {
+        uint32_t deviceMemoryCount = 0;     // Live vkAllocateMemory allocations (compare to maxMemoryAllocationCount)
+        uint32_t blockCount = 0;
+        uint32_t dedicatedCount = 0;
+        uint64_t allocationCount = 0;       // Live sub-allocations and dedicated allocations
+        VkDeviceSize bytesReserved = 0;     // Allocated from Vulkan
+        VkDeviceSize bytesUsed = 0;         // Handed out
+    };
+
+    GpuAllocator() = default;
+    ~GpuAllocator();
+
+    GpuAllocator(const GpuAllocator&) = delete;
+    GpuAllocator& operator=(const GpuAllocator&) = delete;
+
+    // bufferDeviceAddress = the feature is enabled, so every block can back buffers created with SHADER_DEVICE_ADDRESS usage
+    void init(const DeviceDispatch* dispatch, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t apiVersion,
+              bool bufferDeviceAddress = false, VkDeviceSize preferredBlockSize = 64ull * 1024 * 1024);
+
+    // Free every block, all allocations must have been freed already
+    void destroy();
+
+    // Allocate memory for a resource and bind it (dedicated = keep it in its own allocation, e.g. large render targets)
+    GpuAllocation allocateForImage(VkImage image, MemoryUsage usage, bool dedicated = false);
+    GpuAllocation allocateForBuffer(VkBuffer buffer, MemoryUsage usage, bool dedicated = false);
+
+    // Allocate without binding
+    GpuAllocation allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind, bool dedicated = false);
+
+    void free(GpuAllocation& allocation);
+
+    // Make CPU writes visible to the GPU, and GPU writes visible to the CPU, for non-coherent memory (no-ops when coherent)
+    void flush(const GpuAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+    void invalidate(const GpuAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+    // Memory types allowed by allowedTypes, best first for usage
+    std::vector<uint32_t> getMemoryTypeOrder(uint32_t allowedTypes, MemoryUsage usage) const;
+
+    Stats getStats() const;
+
+    // Heap a memory type allocates from
+    uint32_t getHeapIndex(uint32_t memoryType) const;
+    // Allocated from Vulkan by this allocator in one heap
+    VkDeviceSize getHeapReserved(uint32_t heapIndex) const;
+    const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const;
+
+private:
+    static constexpr VkDeviceSize MinNodeSize = 256;
+
+    struct Pool
+    {
+        std::vector<std::unique_ptr<GpuMemoryBlock>> blocks;
+    };
+
+    GpuAllocation allocateDedicated(const VkMemoryRequirements& requirements, uint32_t memoryType, VkImage image, VkBuffer buffer);
+    GpuAllocation allocateFromPool(VkDeviceSize size, uint32_t memoryType, ResourceKind kind);
+    GpuAllocation allocateInternal(const VkMemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind, bool dedicated,
+                                   VkImage image, VkBuffer buffer);
+    VkResult allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, const void* pNext, VkDeviceMemory& memory, uint8_t*& mapped);
+    VkMappedMemoryRange getMappedRange(const GpuAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) const;
+
+    const DeviceDispatch* mDispatch = nullptr;
+    VkDevice mDevice = VK_NULL_HANDLE;
+    uint32_t mApiVersion = VK_API_VERSION_1_0;
+    VkPhysicalDeviceMemoryProperties mMemoryProperties = {};
+    VkDeviceSize mBufferImageGranularity = 1;
+    VkDeviceSize mNonCoherentAtomSize = 1;
+    VkDeviceSize mBlockSizes[VK_MAX_MEMORY_HEAPS] = {};
+    VkDeviceSize mHeapReserved[VK_MAX_MEMORY_HEAPS] = {};
+    bool mSeparateKinds = false;        // Linear and optimal resources get separate blocks
+    bool mBufferDeviceAddress = false;  // Memory is allocated with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT
+
+    std::vector<Pool> mPools;           // Indexed by memory type * 2 + kind
+    mutable std::mutex mMutex;
+    Stats mStats;
+};
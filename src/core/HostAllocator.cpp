@@ -0,0 +1,254 @@
+#include "HostAllocator.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+HostAllocator::HostAllocator(size_t commandArenaSize)
+{
+    mArenaSize = commandArenaSize;
+    mArena.reset(new uint8_t[mArenaSize]);
+
+    mCallbacks.pUserData = this;
+    mCallbacks.pfnAllocation = allocationCallback;
+    mCallbacks.pfnReallocation = reallocationCallback;
+    mCallbacks.pfnFree = freeCallback;
+    mCallbacks.pfnInternalAllocation = internalAllocationCallback;
+    mCallbacks.pfnInternalFree = internalFreeCallback;
+}
+
+HostAllocator::~HostAllocator()
+{
+    // Size class slabs and the arena are freed with the object, anything still live is leaked by the driver
+    for (uint32_t i = 0; i < ScopeCount; i++)
+    {
+        if (mStats[i].liveAllocations.load() > 0)
+        {
+            printf("Host allocator: %llu %s scope allocations (%zu bytes) never freed\n",
+                   static_cast<unsigned long long>(mStats[i].liveAllocations.load()),
+                   getScopeName(static_cast<VkSystemAllocationScope>(i)), mStats[i].bytes.load());
+        }
+    }
+}
+
+const VkAllocationCallbacks* HostAllocator::getCallbacks() const
+{
+    return &mCallbacks;
+}
+
+HostAllocator::ScopeStats HostAllocator::getScopeStats(VkSystemAllocationScope scope) const
+{
+    const AtomicScopeStats& stats = mStats[scope];
+
+    ScopeStats result;
+    result.allocations = stats.allocations.load();
+    result.liveAllocations = stats.liveAllocations.load();
+    result.bytes = stats.bytes.load();
+    result.highWater = stats.highWater.load();
+    result.internalBytes = stats.internalBytes.load();
+    return result;
+}
+
+const char* HostAllocator::getScopeName(VkSystemAllocationScope scope)
+{
+    switch (scope)
+    {
+        case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:  return "command";
+        case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:   return "object";
+        case VK_SYSTEM_ALLOCATION_SCOPE_CACHE:    return "cache";
+        case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE:   return "device";
+        case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+        default:                                  return "unknown";
+    }
+}
+
+// - Callbacks
+void* VKAPI_PTR HostAllocator::allocationCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    return static_cast<HostAllocator*>(userData)->allocate(size, alignment, scope);
+}
+
+void* VKAPI_PTR HostAllocator::reallocationCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    return static_cast<HostAllocator*>(userData)->reallocate(original, size, alignment, scope);
+}
+
+void VKAPI_PTR HostAllocator::freeCallback(void* userData, void* memory)
+{
+    static_cast<HostAllocator*>(userData)->free(memory);
+}
+
+void VKAPI_PTR HostAllocator::internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+    static_cast<HostAllocator*>(userData)->mStats[scope].internalBytes += size;
+}
+
+void VKAPI_PTR HostAllocator::internalFreeCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+    static_cast<HostAllocator*>(userData)->mStats[scope].internalBytes -= size;
+}
+
+// - Allocation
+void* HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    if (size == 0)
+        return nullptr;
+
+    // Room for the header in front, and for moving the pointer up to the alignment asked for
+    alignment = std::max(alignment, alignof(Header));
+    size_t total = size + sizeof(Header) + alignment - 1;
+
+    uint8_t* base = nullptr;
+    Source source = Heap;
+    uint32_t sizeClass = 0;
+
+    if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND)
+    {
+        base = allocateFromArena(total);
+        source = CommandArena;
+    }
+    else if (scope == VK_SYSTEM_ALLOCATION_SCOPE_OBJECT && total <= (MinClassSize << (ClassCount - 1)))
+    {
+        while ((MinClassSize << sizeClass) < total)
+        {
+            sizeClass++;
+        }
+        base = allocateFromClass(sizeClass);
+        source = SizeClass;
+    }
+
+    // Arena full, too big for a size class, or a longer lived scope
+    if (base == nullptr)
+    {
+        base = static_cast<uint8_t*>(malloc(total));
+        source = Heap;
+        if (base == nullptr)
+            return nullptr;
+    }
+
+    uintptr_t address = reinterpret_cast<uintptr_t>(base) + sizeof(Header);
+    address = (address + alignment - 1) / alignment * alignment;
+    uint8_t* memory = reinterpret_cast<uint8_t*>(address);
+
+    Header* header = reinterpret_cast<Header*>(memory) - 1;
+    header->offset = static_cast<uint32_t>(memory - base);
+    header->scope = static_cast<uint8_t>(scope);
+    header->source = source;
+    header->sizeClass = static_cast<uint8_t>(sizeClass);
+    header->size = size;
+
+    AtomicScopeStats& stats = mStats[scope];
+    stats.allocations++;
+    stats.liveAllocations++;
+    size_t bytes = stats.bytes += size;
+    size_t highWater = stats.highWater.load();
+    while (bytes > highWater && !stats.highWater.compare_exchange_weak(highWater, bytes))
+    {
+    }
+
+    return memory;
+}
+
+void* HostAllocator::reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    if (original == nullptr)
+        return allocate(size, alignment, scope);
+
+    if (size == 0)
+    {
+        free(original);
+        return nullptr;
+    }
+
+    // Original is left untouched if the new allocation fails
+    void* memory = allocate(size, alignment, scope);
+    if (memory == nullptr)
+        return nullptr;
+
+    const Header* header = static_cast<const Header*>(original) - 1;
+    memcpy(memory, original, std::min(size, header->size));
+    free(original);
+    return memory;
+}
+
+void HostAllocator::free(void* memory)
+{
+    if (memory == nullptr)
+        return;
+
+    Header header = *(static_cast<Header*>(memory) - 1);
+    uint8_t* base = static_cast<uint8_t*>(memory) - header.offset;
+
+    AtomicScopeStats& stats = mStats[header.scope];
+    stats.liveAllocations--;
+    stats.bytes -= header.size;
+
+    switch (header.source)
+    {
+        case CommandArena:
+            freeToArena();
+            break;
+        case SizeClass:
+            freeToClass(header.sizeClass, base);
+            break;
+        default:
+            ::free(base);
+            break;
+    }
+}
+
+// - Command Arena
+uint8_t* HostAllocator::allocateFromArena(size_t size)
+{
+    std::lock_guard<std::mutex> lock(mArenaMutex);
+
+    // Every block handed out starts max-aligned, so the alignment fix up in allocate stays within total
+    size_t offset = (mArenaHead + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+    if (offset + size > mArenaSize)
+        return nullptr;
+
+    mArenaHead = offset + size;
+    mArenaLive++;
+    return mArena.get() + offset;
+}
+
+void HostAllocator::freeToArena()
+{
+    std::lock_guard<std::mutex> lock(mArenaMutex);
+
+    // Command scope memory is all freed by the time the commands using it return, so the arena empties often
+    if (--mArenaLive == 0)
+    {
+        mArenaHead = 0;
+    }
+}
+
+// - Size Classes
+uint8_t* HostAllocator::allocateFromClass(uint32_t sizeClass)
+{
+    SizeClassPool& pool = mClasses[sizeClass];
+    std::lock_guard<std::mutex> lock(pool.mutex);
+
+    if (pool.freeNodes.empty())
+    {
+        size_t nodeSize = MinClassSize << sizeClass;
+        pool.slabs.emplace_back(new uint8_t[SlabSize]);
+        uint8_t* slab = pool.slabs.back().get();
+        for (size_t offset = 0; offset + nodeSize <= SlabSize; offset += nodeSize)
+        {
+            pool.freeNodes.push_back(slab + offset);
+        }
+    }
+
+    uint8_t* node = pool.freeNodes.back();
+    pool.freeNodes.pop_back();
+    return node;
+}
+
+void HostAllocator::freeToClass(uint32_t sizeClass, uint8_t* node)
+{
+    SizeClassPool& pool = mClasses[sizeClass];
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.freeNodes.push_back(node);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "DeviceDispatch.hpp"
+
+// VkAllocationCallbacks for the driver's host memory, so it can be measured and kept off the global heap lock
+// COMMAND scope allocations (freed before the command returns) come from a linear arena that rewinds once empty,
+// small OBJECT scope allocations from size class free lists, and everything else from malloc
+// Counters and high water marks are kept per allocation scope
+// Thread safe, and must outlive every object created with its callbacks
+class HostAllocator
+{
+public:
+    static constexpr uint32_t ScopeCount = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+    struct ScopeStats
+    {
+        uint64_t allocations = 0;       // Over the whole run
+        uint64_t liveAllocations = 0;
+        size_t bytes = 0;               // Live, as requested by the driver
+        size_t highWater = 0;
+        size_t internalBytes = 0;       // Allocated by the driver itself (executable memory), reported through notifications
+    };
+
+    explicit HostAllocator(size_t commandArenaSize = 256 * 1024);
+    ~HostAllocator();
+
+    HostAllocator(const HostAllocator&) = delete;
+    HostAllocator& operator=(const HostAllocator&) = delete;
+
+    const VkAllocationCallbacks* getCallbacks() const;
+
+    ScopeStats getScopeStats(VkSystemAllocationScope scope) const;
+    static const char* getScopeName(VkSystemAllocationScope scope);
+
+private:
+    static constexpr size_t MinClassSize = 32;          // Smallest size class, must fit a Header
+    static constexpr size_t ClassCount = 8;             // 32 bytes up to 4KB
+    static constexpr size_t SlabSize = 64 * 1024;       // Size classes grow by this much at a time
+
+    enum Source : uint8_t
+    {
+        Heap,
+        CommandArena,
+        SizeClass
+    };
+
+    // Stored just before every pointer handed out
+    struct Header
+    {
+        uint32_t offset;        // From the start of the underlying allocation
+        uint8_t scope;
+        uint8_t source;
+        uint8_t sizeClass;
+        uint8_t padding;
+        size_t size;
+    };
+
+    struct SizeClassPool
+    {
+        std::mutex mutex;
+        std::vector<uint8_t*> freeNodes;
+        std::vector<std::unique_ptr<uint8_t[]>> slabs;
+    };
+
+    struct AtomicScopeStats
+    {
+        std::atomic<uint64_t> allocations{ 0 };
+        std::atomic<uint64_t> liveAllocations{ 0 };
+        std::atomic<size_t> bytes{ 0 };
+        std::atomic<size_t> highWater{ 0 };
+        std::atomic<size_t> internalBytes{ 0 };
+    };
+
+    static void* VKAPI_PTR allocationCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static void* VKAPI_PTR reallocationCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static void VKAPI_PTR freeCallback(void* userData, void* memory);
+    static void VKAPI_PTR internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+    static void VKAPI_PTR internalFreeCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+    void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void* reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void free(void* memory);
+
+    uint8_t* allocateFromArena(size_t size);
+    void freeToArena();
+    uint8_t* allocateFromClass(uint32_t sizeClass);
+    void freeToClass(uint32_t sizeClass, uint8_t* node);
+
+    VkAllocationCallbacks mCallbacks = {};
+
+    // -- COMMAND ARENA --
+    std::mutex mArenaMutex;
+    std::unique_ptr<uint8_t[]> mArena;
+    size_t mArenaSize = 0;
+    size_t mArenaHead = 0;
+    uint32_t mArenaLive = 0;            // Rewinds to the start when this reaches 0
+
+    SizeClassPool mClasses[ClassCount];
+    AtomicScopeStats mStats[ScopeCount];
+};
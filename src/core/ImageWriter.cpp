@@ -0,0 +1,159 @@
+#include "ImageWriter.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+    // CRC-32 lookup table, built once on first use (thread safe as a function local static)
+    struct CrcTable
+    {
+        uint32_t values[256];
+
+        CrcTable()
+        {
+            for (uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                values[n] = c;
+            }
+        }
+    };
+
+    uint32_t updateCrc(uint32_t crc, const uint8_t* data, size_t size)
+    {
+        static const CrcTable table;
+        for (size_t i = 0; i < size; i++)
+        {
+            crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+    void appendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void appendLittleEndian(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 24));
+    }
+
+    // Length, type, data, then CRC of type and data
+    void appendChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+    {
+        appendBigEndian(out, static_cast<uint32_t>(data.size()));
+        size_t typeStart = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+
+        uint32_t crc = updateCrc(0xFFFFFFFFu, out.data() + typeStart, out.size() - typeStart);
+        appendBigEndian(out, crc ^ 0xFFFFFFFFu);
+    }
+
+    bool writeFile(const std::string& path, const std::vector<uint8_t>& data)
+    {
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+
+        size_t written = fwrite(data.data(), 1, data.size(), file);
+        fclose(file);
+        return written == data.size();
+    }
+}
+
+bool ImageWriter::writePng(const std::string& path, uint32_t width, uint32_t height, const uint8_t* rgba)
+{
+    // -- IMAGE DATA --
+    // Each row is prefixed with filter type 0 (none)
+    size_t rowSize = static_cast<size_t>(width) * 4;
+    std::vector<uint8_t> scanlines;
+    scanlines.reserve((rowSize + 1) * height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        scanlines.push_back(0);
+        const uint8_t* row = rgba + y * rowSize;
+        scanlines.insert(scanlines.end(), row, row + rowSize);
+    }
+
+    // zlib stream of stored deflate blocks (at most 65535 bytes each), then the Adler-32 of the raw data
+    std::vector<uint8_t> zlib;
+    zlib.reserve(scanlines.size() + scanlines.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+
+    size_t offset = 0;
+    do
+    {
+        size_t blockSize = std::min<size_t>(65535, scanlines.size() - offset);
+        bool lastBlock = offset + blockSize == scanlines.size();
+        zlib.push_back(lastBlock ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(blockSize));
+        zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+        zlib.push_back(static_cast<uint8_t>(~blockSize));
+        zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+        zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+        offset += blockSize;
+    } while (offset < scanlines.size());
+
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : scanlines)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+
+    // -- FILE --
+    std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    std::vector<uint8_t> header;
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header.push_back(8);        // Bit depth
+    header.push_back(6);        // Colour type: RGBA
+    header.push_back(0);        // Compression: deflate
+    header.push_back(0);        // Filter method: adaptive
+    header.push_back(0);        // Interlace: none
+
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", {});
+
+    return writeFile(path, png);
+}
+
+bool ImageWriter::writeRaw(const std::string& path, uint32_t width, uint32_t height, uint32_t format, uint32_t bytesPerPixel,
+                           uint32_t rowPitch, const uint8_t* pixels)
+{
+    std::vector<uint8_t> raw = { 'L', 'V', 'R', 'I' };
+    appendLittleEndian(raw, 1);
+    appendLittleEndian(raw, width);
+    appendLittleEndian(raw, height);
+    appendLittleEndian(raw, format);
+    appendLittleEndian(raw, bytesPerPixel);
+    appendLittleEndian(raw, rowPitch);
+    raw.insert(raw.end(), pixels, pixels + static_cast<size_t>(rowPitch) * height);
+
+    return writeFile(path, raw);
+}
+
+void ImageWriter::swizzleBgraToRgba(std::vector<uint8_t>& pixels)
+{
+    for (size_t i = 0; i + 3 < pixels.size(); i += 4)
+    {
+        std::swap(pixels[i], pixels[i + 2]);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Writes captured frames to disk, run on worker threads so the render loop never waits on encoding
+namespace ImageWriter
+{
+    // 8-bit RGBA pixels, rows tightly packed
+    // Uses stored (uncompressed) deflate blocks, so it's fast and needs no zlib, at the cost of file size
+    bool writePng(const std::string& path, uint32_t width, uint32_t height, const uint8_t* rgba);
+
+    // Pixels exactly as read back, behind a small header:
+    // "LVRI", version (1), width, height, VkFormat, bytes per pixel, row pitch (all uint32_t little endian)
+    bool writeRaw(const std::string& path, uint32_t width, uint32_t height, uint32_t format, uint32_t bytesPerPixel,
+                  uint32_t rowPitch, const uint8_t* pixels);
+
+    // Swap red and blue in place, for BGRA swapchain images
+    void swizzleBgraToRgba(std::vector<uint8_t>& pixels);
+}
@@ -0,0 +1,121 @@
+#include "LatencyLimiter.hpp"
+
+#include <algorithm>
+#include <thread>
+
+void LatencyLimiter::init(const DeviceDispatch* dispatch, VkDevice device, bool usePresentWait, uint32_t maxQueuedFrames)
+{
+    mDispatch = dispatch;
+    mDevice = device;
+    mUsePresentWait = usePresentWait && dispatch->vkWaitForPresentKHR != nullptr;
+    mMaxQueuedFrames = std::max(1u, std::min(maxQueuedFrames, HistorySize - 1));
+}
+
+void LatencyLimiter::beginFrame(uint64_t frameNumber)
+{
+    // -- DRAIN QUEUE --
+    // Wait until no more than mMaxQueuedFrames frames are ahead of the display
+    if (frameNumber >= mMaxQueuedFrames)
+    {
+        uint64_t waitFrame = frameNumber - mMaxQueuedFrames;
+        PendingFrame& frame = mFrames[waitFrame % HistorySize];
+        if (frame.frameNumber == waitFrame && !frame.completed)
+        {
+            VkResult result = VK_NOT_READY;
+            if (mUsePresentWait && frame.swapchain != VK_NULL_HANDLE)
+            {
+                // OUT_OF_DATE etc. just mean the frame won't be shown, so stop waiting for it
+                result = mDispatch->vkWaitForPresentKHR(mDevice, frame.swapchain, getPresentId(waitFrame), WaitTimeout);
+            }
+            else if (frame.fence != VK_NULL_HANDLE)
+            {
+                result = mDispatch->vkWaitForFences(mDevice, 1, &frame.fence, VK_TRUE, WaitTimeout);
+            }
+
+            if (result == VK_SUCCESS)
+            {
+                frameCompleted(frame, Clock::now());
+            }
+            frame.completed = true;
+        }
+    }
+
+    // -- PACE --
+    // Start the frame late enough that it doesn't have to queue behind the previous one
+    if (mDelayMs > 0.0)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(mDelayMs));
+    }
+
+    mCurrentInputTime = Clock::now();
+}
+
+uint64_t LatencyLimiter::getPresentId(uint64_t frameNumber) const
+{
+    // IDs must be non-zero and increase with every present to a swapchain
+    return mUsePresentWait ? frameNumber + 1 : 0;
+}
+
+void LatencyLimiter::framePresented(uint64_t frameNumber, VkSwapchainKHR swapchain, VkFence fence)
+{
+    PendingFrame& frame = mFrames[frameNumber % HistorySize];
+    frame.frameNumber = frameNumber;
+    frame.swapchain = swapchain;
+    frame.fence = fence;
+    frame.inputTime = mCurrentInputTime;
+    frame.completed = false;
+}
+
+void LatencyLimiter::swapchainDestroyed(VkSwapchainKHR swapchain)
+{
+    // Present IDs can't be waited on once the swapchain is gone, but the frame's fence still tells when it finished
+    for (PendingFrame& frame : mFrames)
+    {
+        if (frame.swapchain == swapchain)
+        {
+            frame.swapchain = VK_NULL_HANDLE;
+        }
+    }
+}
+
+LatencyLimiter::Stats LatencyLimiter::getStats() const
+{
+    Stats stats;
+    stats.usingPresentWait = mUsePresentWait;
+    stats.latencyMs = mLatencyMs;
+    stats.intervalMs = mIntervalMs;
+    stats.delayMs = mDelayMs;
+    return stats;
+}
+
+void LatencyLimiter::frameCompleted(PendingFrame& frame, Clock::time_point completionTime)
+{
+    const double smoothing = 0.1;
+
+    double latencyMs = std::chrono::duration<double, std::milli>(completionTime - frame.inputTime).count();
+    mLatencyMs = mLatencyMs == 0.0 ? latencyMs : mLatencyMs + (latencyMs - mLatencyMs) * smoothing;
+
+    if (mHasCompletion)
+    {
+        double intervalMs = std::chrono::duration<double, std::milli>(completionTime - mLastCompletionTime).count();
+        mIntervalMs = mIntervalMs == 0.0 ? intervalMs : mIntervalMs + (intervalMs - mIntervalMs) * smoothing;
+    }
+    mLastCompletionTime = completionTime;
+    mHasCompletion = true;
+
+    if (mIntervalMs == 0.0)
+        return;
+
+    // Latency beyond one frame interval is time spent queued, sleep that much longer before the next frame
+    // Latency under it means the delay is eating into the frame's work, so back off
+    // Delay is capped below the interval so there is always time left to build the frame
+    const double gain = 0.25;
+    double queuedMs = latencyMs - mIntervalMs;
+    mDelayMs = std::max(0.0, std::min(mDelayMs + queuedMs * gain, mIntervalMs * 0.75));
+
+    // A frame that arrived late missed its slot, give back half the delay straight away
+    if (latencyMs > mIntervalMs * 2.0)
+    {
+        mDelayMs *= 0.5;
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "DeviceDispatch.hpp"
+
+// Keeps the queue of frames between the CPU and the display shallow, so input is sampled as late as possible
+// Waits for an earlier frame to reach the screen (VK_KHR_present_wait) or finish on the GPU (fence fallback),
+// then sleeps just long enough that the new frame doesn't sit in the queue behind it
+class LatencyLimiter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats
+    {
+        bool usingPresentWait = false;
+        double latencyMs = 0.0;         // Input sample to presentation (or GPU completion in fallback), smoothed
+        double intervalMs = 0.0;        // Time between completed frames, smoothed
+        double delayMs = 0.0;           // Sleep currently added before each frame
+    };
+
+    // maxQueuedFrames frames may still be on their way to the screen when a new one starts (at least 1)
+    void init(const DeviceDispatch* dispatch, VkDevice device, bool usePresentWait, uint32_t maxQueuedFrames);
+
+    // Before sampling input for frameNumber: wait for the queue to drain, then pace
+    void beginFrame(uint64_t frameNumber);
+
+    // Present ID to attach to frameNumber's present (0 = not using present IDs)
+    uint64_t getPresentId(uint64_t frameNumber) const;
+
+    // frameNumber was submitted with fence and presented (to swapchain, or VK_NULL_HANDLE when offscreen)
+    void framePresented(uint64_t frameNumber, VkSwapchainKHR swapchain, VkFence fence);
+
+    // Call before destroying a swapchain, frames presented to it are waited on through their fences instead
+    void swapchainDestroyed(VkSwapchainKHR swapchain);
+
+    Stats getStats() const;
+
+private:
+    static const uint32_t HistorySize = 8;                 // Frames tracked, must be more than maxQueuedFrames
+    static const uint64_t WaitTimeout = 100000000;         // 100ms, so a lost present can't hang the render loop
+
+    struct PendingFrame
+    {
+        uint64_t frameNumber = UINT64_MAX;
+        VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        Clock::time_point inputTime;
+        bool completed = false;
+    };
+
+    void frameCompleted(PendingFrame& frame, Clock::time_point completionTime);
+
+    const DeviceDispatch* mDispatch = nullptr;
+    VkDevice mDevice = VK_NULL_HANDLE;
+    bool mUsePresentWait = false;
+    uint32_t mMaxQueuedFrames = 1;
+
+    PendingFrame mFrames[HistorySize];
+    Clock::time_point mCurrentInputTime;
+    Clock::time_point mLastCompletionTime;
+    bool mHasCompletion = false;
+
+    double mLatencyMs = 0.0;
+    double mIntervalMs = 0.0;
+    double mDelayMs = 0.0;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded multi-producer/multi-consumer queue that never takes a lock (D. Vyukov's sequence-numbered ring)
+// Capacity must be a power of two. Pushing to a full queue fails rather than waiting
+template <typename T, size_t Capacity>
+class LockFreeQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "LockFreeQueue capacity must be a power of two");
+
+public:
+    LockFreeQueue()
+    {
+        // Each slot's sequence says which push (or pop, once filled) may use it next
+        for (size_t i = 0; i < Capacity; i++)
+        {
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    bool tryPush(const T& value)
+    {
+        size_t position = mPushPosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot& slot = mSlots[position & (Capacity - 1)];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+            if (difference == 0)
+            {
+                // Slot is free for this position, claim it
+                if (mPushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    slot.value = value;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                // Slot still holds a value from a lap ago, so the queue is full
+                return false;
+            }
+            else
+            {
+                // Another producer claimed this position first
+                position = mPushPosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value)
+    {
+        size_t position = mPopPosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot& slot = mSlots[position & (Capacity - 1)];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+
+            if (difference == 0)
+            {
+                if (mPopPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    value = slot.value;
+                    slot.sequence.store(position + Capacity, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                // Nothing has been pushed to this slot yet, so the queue is empty
+                return false;
+            }
+            else
+            {
+                position = mPopPosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // Keep producer and consumer positions on separate cache lines
+    alignas(64) Slot mSlots[Capacity];
+    alignas(64) std::atomic<size_t> mPushPosition{0};
+    alignas(64) std::atomic<size_t> mPopPosition{0};
+};
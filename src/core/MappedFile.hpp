@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read only memory mapping of a whole file, so loaders can hand file contents to Vulkan without reading them into a buffer first
+// Pages are only read from disk when touched
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // False if the file can't be opened or mapped (an empty file maps to nothing, but still succeeds)
+    bool open(const std::string& path);
+    void close();
+
+    const uint8_t* getData() const;
+    size_t getSize() const;
+    bool isOpen() const;
+
+private:
+    const uint8_t* mData = nullptr;
+    size_t mSize = 0;
+    bool mOpen = false;
+#ifdef _WIN32
+    void* mFile = nullptr;          // HANDLE
+    void* mMapping = nullptr;       // HANDLE
+#endif
+};
@@ -0,0 +1,113 @@
+#include "PerformanceWarningCounter.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+void PerformanceWarningCounter::record(int32_t messageId, const char* messageIdName)
+{
+    // Open addressing, starting from a hash of the ID
+    size_t start = ((uint32_t)messageId * 2654435761u) % Capacity;
+    for (size_t probe = 0; probe < Capacity; probe++)
+    {
+        Slot& slot = mSlots[(start + probe) % Capacity];
+        uint32_t state = slot.state.load(std::memory_order_acquire);
+
+        // Claim an empty slot for this ID
+        if (state == Empty)
+        {
+            uint32_t expected = Empty;
+            if (slot.state.compare_exchange_strong(expected, Claiming, std::memory_order_acq_rel))
+            {
+                slot.messageId = messageId;
+                strncpy(slot.name, messageIdName != nullptr ? messageIdName : "", sizeof(slot.name) - 1);
+                slot.state.store(Ready, std::memory_order_release);
+                state = Ready;
+            }
+            else
+            {
+                state = expected;
+            }
+        }
+
+        // Another thread is still filling this slot in, wait for it to know whose it is
+        while (state == Claiming)
+        {
+            std::this_thread::yield();
+            state = slot.state.load(std::memory_order_acquire);
+        }
+
+        if (slot.messageId == messageId)
+        {
+            slot.runTotal.fetch_add(1, std::memory_order_relaxed);
+            slot.frameTotal.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    mOverflow.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PerformanceWarningCounter::endFrame()
+{
+    mLastFrameTotal = 0;
+    for (auto& slot : mSlots)
+    {
+        slot.lastFrameTotal = slot.frameTotal.exchange(0, std::memory_order_relaxed);
+        mLastFrameTotal += slot.lastFrameTotal;
+    }
+}
+
+std::vector<PerformanceWarningCounter::Count> PerformanceWarningCounter::getTop(size_t count) const
+{
+    std::vector<Count> counts;
+    for (const auto& slot : mSlots)
+    {
+        if (slot.state.load(std::memory_order_acquire) != Ready)
+            continue;
+
+        counts.push_back({ slot.messageId, slot.name, slot.runTotal.load(std::memory_order_relaxed), slot.lastFrameTotal });
+    }
+
+    std::sort(counts.begin(), counts.end(), [](const Count& a, const Count& b) { return a.runTotal > b.runTotal; });
+    if (counts.size() > count)
+    {
+        counts.resize(count);
+    }
+    return counts;
+}
+
+uint64_t PerformanceWarningCounter::getRunTotal() const
+{
+    uint64_t total = mOverflow.load(std::memory_order_relaxed);
+    for (const auto& slot : mSlots)
+    {
+        total += slot.runTotal.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint32_t PerformanceWarningCounter::getLastFrameTotal() const
+{
+    return mLastFrameTotal;
+}
+
+void PerformanceWarningCounter::printReport(size_t topCount) const
+{
+    uint64_t runTotal = getRunTotal();
+    if (runTotal == 0)
+        return;
+
+    printf("Performance warnings: %llu in total\n", (unsigned long long)runTotal);
+    for (const auto& count : getTop(topCount))
+    {
+        printf("  %10llu  [%d] %s\n", (unsigned long long)count.runTotal, count.messageId, count.name.c_str());
+    }
+
+    uint64_t overflow = mOverflow.load(std::memory_order_relaxed);
+    if (overflow > 0)
+    {
+        printf("  %10llu  (message IDs beyond the first %zu)\n", (unsigned long long)overflow, Capacity);
+    }
+}
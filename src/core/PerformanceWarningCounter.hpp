@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Counts performance warnings from the debug messenger by message ID, per frame and over the whole run
+// record() is lock free and can be called from any driver thread, everything else is for the render thread
+class PerformanceWarningCounter
+{
+public:
+    struct Count
+    {
+        int32_t messageId;
+        std::string name;           // pMessageIdName of the first message with this ID
+        uint64_t runTotal;
+        uint32_t lastFrameTotal;
+    };
+
+    void record(int32_t messageId, const char* messageIdName);
+
+    // Close off the current frame's counts
+    void endFrame();
+
+    // Most frequent warnings over the run, highest first
+    std::vector<Count> getTop(size_t count) const;
+    uint64_t getRunTotal() const;
+    uint32_t getLastFrameTotal() const;
+
+    void printReport(size_t topCount) const;
+
+private:
+    static const size_t Capacity = 256;     // Distinct message IDs tracked, anything beyond is only counted in mOverflow
+
+    enum SlotState : uint32_t
+    {
+        Empty,
+        Claiming,   // A thread is writing the ID and name
+        Ready
+    };
+
+    struct Slot
+    {
+        std::atomic<uint32_t> state{Empty};
+        int32_t messageId = 0;
+        char name[96] = {};
+        std::atomic<uint64_t> runTotal{0};
+        std::atomic<uint32_t> frameTotal{0};
+        uint32_t lastFrameTotal = 0;
+    };
+
+    Slot mSlots[Capacity];
+    std::atomic<uint64_t> mOverflow{0};
+    uint32_t mLastFrameTotal = 0;
+};
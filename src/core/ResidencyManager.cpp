@@ -0,0 +1,187 @@
+#include "ResidencyManager.hpp"
+
+#include <algorithm>
+
+void ResidencyManager::init(VkPhysicalDevice physicalDevice, const GpuAllocator* allocator, bool useMemoryBudget,
+                            float evictThreshold, float targetRatio)
+{
+    mPhysicalDevice = physicalDevice;
+    mAllocator = allocator;
+    mUseMemoryBudget = useMemoryBudget;
+    mEvictThreshold = evictThreshold;
+    mTargetRatio = std::min(targetRatio, evictThreshold);
+
+    const VkPhysicalDeviceMemoryProperties& memoryProperties = mAllocator->getMemoryProperties();
+    mHeaps.resize(memoryProperties.memoryHeapCount);
+    mReportedUsage.assign(memoryProperties.memoryHeapCount, 0);
+    mEvictedCredit.assign(memoryProperties.memoryHeapCount, 0);
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+    {
+        mHeaps[i].size = memoryProperties.memoryHeaps[i].size;
+        mHeaps[i].deviceLocal = memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    }
+
+    queryBudgets();
+}
+
+ResidencyManager::Handle ResidencyManager::add(const GpuAllocation& allocation, uint64_t frameNumber, EvictCallback evict)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Resource resource;
+    resource.handle = mNextHandle++;
+    resource.heapIndex = mAllocator->getHeapIndex(allocation.memoryType);
+    resource.size = allocation.size;
+    resource.evict = std::move(evict);
+
+    // Newly loaded counts as most recently used, by the frame being recorded (which may not have been submitted yet)
+    resource.lastUsed = frameNumber;
+
+    // New resources fill the space freed by evictions before the reported usage grows
+    VkDeviceSize& credit = mEvictedCredit[resource.heapIndex];
+    credit -= std::min(credit, allocation.size);
+
+    mResources.push_back(std::move(resource));
+    mLookup[mResources.back().handle] = std::prev(mResources.end());
+
+    mStats.resources++;
+    mStats.residentBytes += allocation.size;
+    return mResources.back().handle;
+}
+
+void ResidencyManager::remove(Handle handle)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mLookup.find(handle);
+    if (it == mLookup.end())
+        return;
+
+    mStats.resources--;
+    mStats.residentBytes -= it->second->size;
+    mResources.erase(it->second);
+    mLookup.erase(it);
+}
+
+void ResidencyManager::touch(Handle handle, uint64_t frameNumber)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mLookup.find(handle);
+    if (it == mLookup.end())
+        return;
+
+    // Move to the back, keeps the list in least recently used order without sorting
+    it->second->lastUsed = std::max(it->second->lastUsed, frameNumber);
+    mResources.splice(mResources.end(), mResources, it->second);
+}
+
+void ResidencyManager::update(uint64_t framesCompleted)
+{
+    std::vector<EvictCallback> evictions;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        queryBudgets();
+
+        // Bytes each heap has to give up to get back under its target
+        std::vector<VkDeviceSize> excess(mHeaps.size(), 0);
+        bool overBudget = false;
+        for (size_t i = 0; i < mHeaps.size(); i++)
+        {
+            const HeapBudget& heap = mHeaps[i];
+            if (heap.budget == 0 || static_cast<double>(heap.usage) <= heap.budget * static_cast<double>(mEvictThreshold))
+                continue;
+
+            VkDeviceSize target = static_cast<VkDeviceSize>(heap.budget * static_cast<double>(mTargetRatio));
+            excess[i] = heap.usage - target;
+            overBudget = true;
+        }
+
+        // Oldest first, stopping at the first resource a frame in flight might still be reading
+        auto it = mResources.begin();
+        while (overBudget && it != mResources.end() && it->lastUsed < framesCompleted && evictions.size() < MaxEvictionsPerUpdate)
+        {
+            if (excess[it->heapIndex] == 0)
+            {
+                ++it;
+                continue;
+            }
+
+            excess[it->heapIndex] -= std::min(excess[it->heapIndex], it->size);
+            mHeaps[it->heapIndex].usage -= std::min(mHeaps[it->heapIndex].usage, it->size);
+            mEvictedCredit[it->heapIndex] += it->size;
+
+            mStats.resources--;
+            mStats.residentBytes -= it->size;
+            mStats.evictions++;
+            mStats.evictedBytes += it->size;
+
+            evictions.push_back(std::move(it->evict));
+            mLookup.erase(it->handle);
+            it = mResources.erase(it);
+
+            overBudget = std::any_of(excess.begin(), excess.end(), [](VkDeviceSize bytes) { return bytes > 0; });
+        }
+    }
+
+    // Outside the lock, so owners can free memory (and register replacements) from the callback
+    for (auto& evict : evictions)
+    {
+        evict();
+    }
+}
+
+void ResidencyManager::queryBudgets()
+{
+    if (mUseMemoryBudget)
+    {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2 memoryProperties = {};
+        memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memoryProperties.pNext = &budgetProperties;
+
+        vkGetPhysicalDeviceMemoryProperties2(mPhysicalDevice, &memoryProperties);
+
+        for (size_t i = 0; i < mHeaps.size(); i++)
+        {
+            mHeaps[i].budget = budgetProperties.heapBudget[i];
+            mHeaps[i].usage = budgetProperties.heapUsage[i];
+        }
+    }
+    else
+    {
+        // No extension: 80% of the heap, leaving room for other processes and the driver
+        for (size_t i = 0; i < mHeaps.size(); i++)
+        {
+            mHeaps[i].budget = mHeaps[i].size / 10 * 8;
+            mHeaps[i].usage = mAllocator->getHeapReserved(static_cast<uint32_t>(i));
+        }
+    }
+
+    // Evicted memory only shows up in the reported usage once the driver updates it or the allocator frees a whole block,
+    // so it's taken off here, and the credit shrinks by however much the reported usage has dropped since last time
+    for (size_t i = 0; i < mHeaps.size(); i++)
+    {
+        VkDeviceSize reported = mHeaps[i].usage;
+        if (reported < mReportedUsage[i])
+        {
+            mEvictedCredit[i] -= std::min(mEvictedCredit[i], mReportedUsage[i] - reported);
+        }
+        mReportedUsage[i] = reported;
+        mHeaps[i].usage = reported - std::min(reported, mEvictedCredit[i]);
+    }
+}
+
+std::vector<ResidencyManager::HeapBudget> ResidencyManager::getHeapBudgets() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHeaps;
+}
+
+ResidencyManager::Stats ResidencyManager::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
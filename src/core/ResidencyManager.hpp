@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "GpuAllocator.hpp"
+
+// Tracks device memory budget per heap and evicts streaming resources, least recently used first, when a heap nears its budget
+// Budget and usage come from VK_EXT_memory_budget when enabled (usage then includes other processes and the driver),
+// otherwise from a fixed fraction of the heap size against what GpuAllocator has allocated
+// Thread safe
+class ResidencyManager
+{
+public:
+    using Handle = uint64_t;
+    using EvictCallback = std::function<void()>;
+
+    struct HeapBudget
+    {
+        VkDeviceSize size = 0;
+        VkDeviceSize budget = 0;        // How much this process can use before the driver starts paging
+        VkDeviceSize usage = 0;
+        bool deviceLocal = false;
+    };
+
+    struct Stats
+    {
+        uint32_t resources = 0;             // Streaming resources resident
+        VkDeviceSize residentBytes = 0;
+        uint64_t evictions = 0;
+        VkDeviceSize evictedBytes = 0;
+    };
+
+    // Heaps start evicting above evictThreshold of their budget, and evict down to targetRatio of it
+    void init(VkPhysicalDevice physicalDevice, const GpuAllocator* allocator, bool useMemoryBudget,
+              float evictThreshold = 0.9f, float targetRatio = 0.8f);
+
+    // Register a streaming resource that can be dropped and streamed back in later
+    // evict is called (from update, on the render thread) once no frame in flight uses it, and must free its memory
+    // frameNumber is the frame being recorded when it's added, it counts as used by that frame
+    Handle add(const GpuAllocation& allocation, uint64_t frameNumber, EvictCallback evict);
+    // Resource freed by its owner, no-op if it has already been evicted
+    void remove(Handle handle);
+    // Resource is used by frameNumber
+    void touch(Handle handle, uint64_t frameNumber);
+
+    // Once a frame: refresh budgets and evict from heaps over budget
+    // Only resources last used before framesCompleted (every frame numbered below it has finished) can be evicted
+    void update(uint64_t framesCompleted);
+
+    std::vector<HeapBudget> getHeapBudgets() const;
+    Stats getStats() const;
+
+private:
+    static const uint32_t MaxEvictionsPerUpdate = 16;     // Spreads a large eviction over frames, so one update can't drop everything
+
+    struct Resource
+    {
+        Handle handle = 0;
+        uint32_t heapIndex = 0;
+        VkDeviceSize size = 0;
+        uint64_t lastUsed = 0;
+        EvictCallback evict;
+    };
+
+    void queryBudgets();
+
+    VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+    const GpuAllocator* mAllocator = nullptr;
+    bool mUseMemoryBudget = false;
+    float mEvictThreshold = 0.9f;
+    float mTargetRatio = 0.8f;
+
+    mutable std::mutex mMutex;
+    std::vector<HeapBudget> mHeaps;
+    std::vector<VkDeviceSize> mReportedUsage;                           // Usage as last reported (driver or allocator blocks)
+    std::vector<VkDeviceSize> mEvictedCredit;                           // Evicted bytes the reported usage doesn't show yet
+    std::list<Resource> mResources;                                     // Least recently used first
+    std::unordered_map<Handle, std::list<Resource>::iterator> mLookup;
+    Handle mNextHandle = 1;
+    Stats mStats;
+};
@@ -0,0 +1,54 @@
+#include "ResolutionController.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void ResolutionController::init(float minScale, float maxScale, double budgetMs)
+{
+    mMinScale = std::max(0.1f, std::min(minScale, maxScale));
+    mMaxScale = std::max(mMinScale, maxScale);
+    mScale = mMaxScale;
+    mBudgetMs = budgetMs;
+    mGpuTimeMs = 0.0;
+}
+
+float ResolutionController::update(double gpuTimeMs)
+{
+    if (gpuTimeMs <= 0.0)
+        return mScale;
+
+    // Smooth out single frame spikes, but react to a sustained change within a few frames
+    const double smoothing = 0.2;
+    mGpuTimeMs = mGpuTimeMs == 0.0 ? gpuTimeMs : mGpuTimeMs + (gpuTimeMs - mGpuTimeMs) * smoothing;
+
+    // Scale that would have hit the budget exactly, aiming slightly under it for headroom
+    const double headroom = 0.9;
+    float target = mScale * static_cast<float>(std::sqrt(mBudgetMs * headroom / mGpuTimeMs));
+    target = std::max(mMinScale, std::min(mMaxScale, target));
+
+    // Drop quickly when over budget, recover slowly so it doesn't oscillate
+    // Dead band is on the distance to the target (not the step), and inside it the scale snaps to the target, so a slow
+    // recovery still gets all the way back to full resolution
+    float error = target - mScale;
+    if (std::fabs(error) <= 0.01f)
+    {
+        mScale = target;
+    }
+    else
+    {
+        float rate = error < 0.0f ? 0.5f : 0.1f;
+        mScale += error * rate;
+    }
+
+    return mScale;
+}
+
+float ResolutionController::getScale() const
+{
+    return mScale;
+}
+
+double ResolutionController::getGpuTimeMs() const
+{
+    return mGpuTimeMs;
+}
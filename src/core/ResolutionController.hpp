@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Picks the render resolution scale for each frame from measured GPU frame time
+// Cost is treated as proportional to pixel count, so scale moves with the square root of budget / time
+class ResolutionController
+{
+public:
+    // Scale is a fraction of the output extent on each axis, kept within [minScale, maxScale]
+    void init(float minScale, float maxScale, double budgetMs);
+
+    // Feed in the GPU time of a finished frame, returns the scale to use for the next one
+    float update(double gpuTimeMs);
+
+    float getScale() const;
+    double getGpuTimeMs() const;
+
+private:
+    float mMinScale = 1.0f;
+    float mMaxScale = 1.0f;
+    float mScale = 1.0f;
+    double mBudgetMs = 16.0;
+    double mGpuTimeMs = 0.0;        // Smoothed
+};
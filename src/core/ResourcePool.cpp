@@ -0,0 +1,333 @@
+#include "ResourcePool.hpp"
+
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+    // FNV-1a over each field in turn
+    class Hasher
+    {
+    public:
+        template <typename T>
+        void add(const T& value)
+        {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+            for (size_t i = 0; i < sizeof(T); i++)
+            {
+                mHash = (mHash ^ bytes[i]) * 1099511628211ull;
+            }
+        }
+
+        uint64_t get() const
+        {
+            return mHash;
+        }
+
+    private:
+        uint64_t mHash = 14695981039346656037ull;
+    };
+}
+
+bool ResourcePool::ImageDesc::operator==(const ImageDesc& other) const
+{
+    return extent.width == other.extent.width && extent.height == other.extent.height && extent.depth == other.extent.depth
+           && format == other.format && usage == other.usage && samples == other.samples && aspect == other.aspect
+           && mipLevels == other.mipLevels && arrayLayers == other.arrayLayers;
+}
+
+bool ResourcePool::BufferDesc::operator==(const BufferDesc& other) const
+{
+    return size == other.size && usage == other.usage && memoryUsage == other.memoryUsage;
+}
+
+void ResourcePool::init(GpuAllocator* allocator, const DeviceDispatch* dispatch, VkDevice device, uint32_t maxIdleFrames)
+{
+    mAllocator = allocator;
+    mDispatch = dispatch;
+    mDevice = device;
+    mMaxIdleFrames = maxIdleFrames;
+}
+
+void ResourcePool::destroy()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (auto& bucket : mImages)
+    {
+        for (auto& entry : bucket.second)
+        {
+            destroyImage(entry.resource);
+        }
+    }
+    for (auto& bucket : mBuffers)
+    {
+        for (auto& entry : bucket.second)
+        {
+            destroyBuffer(entry.resource);
+        }
+    }
+    mImages.clear();
+    mBuffers.clear();
+    mStats.idleImages = 0;
+    mStats.idleBuffers = 0;
+}
+
+ResourcePool::Image ResourcePool::acquireImage(const ImageDesc& desc)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Image image;
+    if (takeIdle(mImages, desc, image))
+    {
+        mStats.idleImages--;
+        return image;
+    }
+    return createImage(desc);
+}
+
+ResourcePool::Buffer ResourcePool::acquireBuffer(const BufferDesc& desc)
+{
+    // Nearby sizes share a class, so buffers that grow a little at a time still get reused
+    BufferDesc classDesc = desc;
+    classDesc.size = getSizeClass(desc.size);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Buffer buffer;
+    if (takeIdle(mBuffers, classDesc, buffer))
+    {
+        mStats.idleBuffers--;
+        return buffer;
+    }
+    return createBuffer(classDesc);
+}
+
+void ResourcePool::release(Image& image, uint64_t value)
+{
+    if (image.image == VK_NULL_HANDLE)
+        return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mImages[hash(image.desc)].push_back({ image, value });
+    mStats.idleImages++;
+    image = Image();
+}
+
+void ResourcePool::release(Buffer& buffer, uint64_t value)
+{
+    if (buffer.buffer == VK_NULL_HANDLE)
+        return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBuffers[hash(buffer.desc)].push_back({ buffer, value });
+    mStats.idleBuffers++;
+    buffer = Buffer();
+}
+
+void ResourcePool::update(uint64_t completedValue)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCompletedValue = completedValue;
+
+    mStats.idleImages -= ageOut(mImages, [this](Image& image) { destroyImage(image); });
+    mStats.idleBuffers -= ageOut(mBuffers, [this](Buffer& buffer) { destroyBuffer(buffer); });
+}
+
+ResourcePool::Stats ResourcePool::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+VkDeviceSize ResourcePool::getSizeClass(VkDeviceSize size)
+{
+    // Four classes per power of two (1, 1.25, 1.5, 1.75 x), so no more than a quarter is wasted
+    const VkDeviceSize minSize = 256;
+    if (size <= minSize)
+        return minSize;
+
+    VkDeviceSize powerOfTwo = minSize;
+    while (powerOfTwo * 2 <= size)
+    {
+        powerOfTwo *= 2;
+    }
+    VkDeviceSize step = powerOfTwo / 4;
+    return (size + step - 1) / step * step;
+}
+
+// - Pooling
+uint64_t ResourcePool::hash(const ImageDesc& desc)
+{
+    Hasher hasher;
+    hasher.add(desc.extent.width);
+    hasher.add(desc.extent.height);
+    hasher.add(desc.extent.depth);
+    hasher.add(desc.format);
+    hasher.add(desc.usage);
+    hasher.add(desc.samples);
+    hasher.add(desc.aspect);
+    hasher.add(desc.mipLevels);
+    hasher.add(desc.arrayLayers);
+    return hasher.get();
+}
+
+uint64_t ResourcePool::hash(const BufferDesc& desc)
+{
+    Hasher hasher;
+    hasher.add(desc.size);
+    hasher.add(desc.usage);
+    hasher.add(desc.memoryUsage);
+    return hasher.get();
+}
+
+template <typename Resource, typename Desc>
+bool ResourcePool::takeIdle(Buckets<Resource>& buckets, const Desc& desc, Resource& resource)
+{
+    auto bucket = buckets.find(hash(desc));
+    if (bucket == buckets.end())
+        return false;
+
+    // Oldest first, it's the most likely to have finished
+    auto& entries = bucket->second;
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+    {
+        if (it->value > mCompletedValue || !(it->resource.desc == desc))
+            continue;
+
+        resource = it->resource;
+        entries.erase(it);
+        if (entries.empty())
+        {
+            buckets.erase(bucket);
+        }
+        mStats.reused++;
+        return true;
+    }
+    return false;
+}
+
+template <typename Resource, typename Destroy>
+uint32_t ResourcePool::ageOut(Buckets<Resource>& buckets, Destroy destroy)
+{
+    uint32_t destroyed = 0;
+    for (auto bucket = buckets.begin(); bucket != buckets.end();)
+    {
+        auto& entries = bucket->second;
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->value + mMaxIdleFrames > mCompletedValue)
+            {
+                ++it;
+                continue;
+            }
+
+            destroy(it->resource);
+            it = entries.erase(it);
+            destroyed++;
+        }
+
+        bucket = entries.empty() ? buckets.erase(bucket) : std::next(bucket);
+    }
+
+    mStats.agedOut += destroyed;
+    return destroyed;
+}
+
+// - Create Functions
+ResourcePool::Image ResourcePool::createImage(const ImageDesc& desc)
+{
+    Image image;
+    image.desc = desc;
+
+    VkImageCreateInfo imageCreateInfo = {};
+    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCreateInfo.imageType = desc.extent.depth > 1 ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D;
+    imageCreateInfo.extent = desc.extent;
+    imageCreateInfo.mipLevels = desc.mipLevels;
+    imageCreateInfo.arrayLayers = desc.arrayLayers;
+    imageCreateInfo.format = desc.format;
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageCreateInfo.usage = desc.usage;
+    imageCreateInfo.samples = desc.samples;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (mDispatch->vkCreateImage(mDevice, &imageCreateInfo, mDispatch->allocator, &image.image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Pooled Image!");
+    }
+
+    // Render targets (screen sized, often compressed by the driver) get their own allocation, as createColourImage does
+    // Other transient images are recycled rather than freed, so they can live in shared blocks
+    bool renderTarget = (desc.usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) != 0;
+    image.allocation = mAllocator->allocateForImage(image.image, MemoryUsage::GpuOnly, renderTarget);
+
+    VkImageViewCreateInfo viewCreateInfo = {};
+    viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewCreateInfo.image = image.image;
+    if (desc.extent.depth > 1)
+    {
+        viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_3D;
+    }
+    else
+    {
+        viewCreateInfo.viewType = desc.arrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+    }
+    viewCreateInfo.format = desc.format;
+    viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+    viewCreateInfo.subresourceRange.aspectMask = desc.aspect;
+    viewCreateInfo.subresourceRange.baseMipLevel = 0;
+    viewCreateInfo.subresourceRange.levelCount = desc.mipLevels;
+    viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+    viewCreateInfo.subresourceRange.layerCount = desc.arrayLayers;
+
+    if (mDispatch->vkCreateImageView(mDevice, &viewCreateInfo, mDispatch->allocator, &image.imageView) != VK_SUCCESS)
+    {
+        destroyImage(image);
+        throw std::runtime_error("Failed to create a Pooled Image View!");
+    }
+
+    mStats.created++;
+    return image;
+}
+
+ResourcePool::Buffer ResourcePool::createBuffer(const BufferDesc& desc)
+{
+    Buffer buffer;
+    buffer.desc = desc;
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = desc.size;
+    bufferInfo.usage = desc.usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (mDispatch->vkCreateBuffer(mDevice, &bufferInfo, mDispatch->allocator, &buffer.buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Pooled Buffer!");
+    }
+
+    buffer.allocation = mAllocator->allocateForBuffer(buffer.buffer, desc.memoryUsage);
+
+    mStats.created++;
+    return buffer;
+}
+
+void ResourcePool::destroyImage(Image& image)
+{
+    mDispatch->vkDestroyImageView(mDevice, image.imageView, mDispatch->allocator);
+    mDispatch->vkDestroyImage(mDevice, image.image, mDispatch->allocator);
+    if (image.allocation.memory != VK_NULL_HANDLE)
+    {
+        mAllocator->free(image.allocation);
+    }
+    image = Image();
+}
+
+void ResourcePool::destroyBuffer(Buffer& buffer)
+{
+    mDispatch->vkDestroyBuffer(mDevice, buffer.buffer, mDispatch->allocator);
+    mAllocator->free(buffer.allocation);
+    buffer = Buffer();
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "DeviceDispatch.hpp"
+#include "GpuAllocator.hpp"
+
+// Recycles transient images and buffers (render targets, scratch and readback buffers) instead of destroying them
+// Released resources are keyed by a hash of what they were created with, and handed back out once the frame that
+// released them has finished. Ones left unused for maxIdleFrames are destroyed
+// Thread safe
+class ResourcePool
+{
+public:
+    struct ImageDesc
+    {
+        VkExtent3D extent = { 1, 1, 1 };
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkImageUsageFlags usage = 0;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;     // Of the view created with it
+        uint32_t mipLevels = 1;
+        uint32_t arrayLayers = 1;
+
+        bool operator==(const ImageDesc& other) const;
+    };
+
+    struct BufferDesc
+    {
+        VkDeviceSize size = 0;                  // Rounded up to a size class when acquired
+        VkBufferUsageFlags usage = 0;
+        MemoryUsage memoryUsage = MemoryUsage::GpuOnly;
+
+        bool operator==(const BufferDesc& other) const;
+    };
+
+    struct Image
+    {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView imageView = VK_NULL_HANDLE;
+        GpuAllocation allocation;
+        ImageDesc desc;
+    };
+
+    struct Buffer
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        GpuAllocation allocation;
+        BufferDesc desc;                        // desc.size is the usable size
+    };
+
+    struct Stats
+    {
+        uint64_t created = 0;
+        uint64_t reused = 0;
+        uint64_t agedOut = 0;                   // Destroyed after sitting unused
+        uint32_t idleImages = 0;
+        uint32_t idleBuffers = 0;
+    };
+
+    void init(GpuAllocator* allocator, const DeviceDispatch* dispatch, VkDevice device, uint32_t maxIdleFrames = 120);
+    // Destroy every idle resource, anything still acquired has to be released first
+    void destroy();
+
+    Image acquireImage(const ImageDesc& desc);
+    Buffer acquireBuffer(const BufferDesc& desc);
+
+    // Reusable once completedValue (in update) reaches value, e.g. the number of the first frame that doesn't use it
+    void release(Image& image, uint64_t value);
+    void release(Buffer& buffer, uint64_t value);
+
+    // Once a frame, with the same timeline as release: makes released resources available and ages out unused ones
+    void update(uint64_t completedValue);
+
+    Stats getStats() const;
+
+    // Size a buffer of size is actually created with
+    static VkDeviceSize getSizeClass(VkDeviceSize size);
+
+private:
+    template <typename Resource>
+    struct Entry
+    {
+        Resource resource;
+        uint64_t value;             // Reusable once the completed value reaches this
+    };
+
+    // Keyed by the descriptor's hash, a bucket can hold different descriptors that collide, oldest release first
+    template <typename Resource>
+    using Buckets = std::unordered_map<uint64_t, std::vector<Entry<Resource>>>;
+
+    static uint64_t hash(const ImageDesc& desc);
+    static uint64_t hash(const BufferDesc& desc);
+
+    template <typename Resource, typename Desc>
+    bool takeIdle(Buckets<Resource>& buckets, const Desc& desc, Resource& resource);
+    template <typename Resource, typename Destroy>
+    uint32_t ageOut(Buckets<Resource>& buckets, Destroy destroy);
+
+    Image createImage(const ImageDesc& desc);
+    Buffer createBuffer(const BufferDesc& desc);
+    void destroyImage(Image& image);
+    void destroyBuffer(Buffer& buffer);
+
+    GpuAllocator* mAllocator = nullptr;
+    const DeviceDispatch* mDispatch = nullptr;
+    VkDevice mDevice = VK_NULL_HANDLE;
+    uint32_t mMaxIdleFrames = 120;
+
+    mutable std::mutex mMutex;
+    uint64_t mCompletedValue = 0;
+    Buckets<Image> mImages;
+    Buckets<Buffer> mBuffers;
+    Stats mStats;
+};
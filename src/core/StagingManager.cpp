@@ -0,0 +1,669 @@
+#include "StagingManager.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+
+void StagingManager::init(GpuAllocator* allocator, const DeviceDispatch* dispatch, VkDevice device,
+                          VkQueue transferQueue, uint32_t transferFamily, VkQueue graphicsQueue, uint32_t graphicsFamily,
+                          bool timelineSemaphores, VkDeviceSize chunkSize)
+{
+    mAllocator = allocator;
+    mDispatch = dispatch;
+    mDevice = device;
+    mGraphicsFamily = graphicsFamily;
+    mChunkSize = chunkSize;
+
+    // Graphics has to wait for a batch on another queue, which needs a timeline semaphore
+    // Without one, batches are submitted ahead of the frame on the graphics queue and ordered with a barrier
+    if (timelineSemaphores)
+    {
+        mQueue = transferQueue;
+        mQueueFamily = transferFamily;
+
+        VkSemaphoreTypeCreateInfo typeInfo = {};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+
+        if (mDispatch->vkCreateSemaphore(mDevice, &semaphoreInfo, mDispatch->allocator, &mTimeline) != VK_SUCCESS
+            || mDispatch->vkCreateSemaphore(mDevice, &semaphoreInfo, mDispatch->allocator, &mGraphicsTimeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create a Timeline Semaphore!");
+        }
+    }
+    else
+    {
+        mQueue = graphicsQueue;
+        mQueueFamily = graphicsFamily;
+    }
+    mTransferOwnership = mQueueFamily != mGraphicsFamily;
+    mSharedFamilies[0] = mGraphicsFamily;
+    mSharedFamilies[1] = mQueueFamily;
+}
+
+void StagingManager::setUploadCallback(std::function<void()> callback)
+{
+    mUploadCallback = std::move(callback);
+}
+
+void StagingManager::setBufferSharing(VkBufferCreateInfo& bufferInfo) const
+{
+    if (mTransferOwnership)
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = 2;
+        bufferInfo.pQueueFamilyIndices = mSharedFamilies;
+    }
+    else
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        bufferInfo.queueFamilyIndexCount = 0;
+        bufferInfo.pQueueFamilyIndices = nullptr;
+    }
+}
+
+void StagingManager::destroy()
+{
+    if (mDevice == VK_NULL_HANDLE)
+        return;
+
+    for (auto& batch : mBatches)
+    {
+        if (batch.inFlight)
+        {
+            mDispatch->vkWaitForFences(mDevice, 1, &batch.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        }
+        for (auto& chunk : batch.chunks)
+        {
+            destroyChunk(chunk);
+        }
+        mDispatch->vkDestroyFence(mDevice, batch.fence, mDispatch->allocator);
+        mDispatch->vkDestroyCommandPool(mDevice, batch.commandPool, mDispatch->allocator);
+    }
+    mBatches.clear();
+
+    for (auto& chunk : mCollecting.chunks)
+    {
+        destroyChunk(chunk);
+    }
+    for (auto& chunk : mClosed.chunks)
+    {
+        destroyChunk(chunk);
+    }
+    for (auto& chunk : mFreeChunks)
+    {
+        destroyChunk(chunk);
+    }
+    mCollecting = Collection();
+    mClosed = Collection();
+    mFreeChunks.clear();
+    mPendingAcquires.clear();
+
+    if (mTimeline != VK_NULL_HANDLE)
+    {
+        mDispatch->vkDestroySemaphore(mDevice, mTimeline, mDispatch->allocator);
+        mDispatch->vkDestroySemaphore(mDevice, mGraphicsTimeline, mDispatch->allocator);
+        mTimeline = VK_NULL_HANDLE;
+        mGraphicsTimeline = VK_NULL_HANDLE;
+    }
+    mDevice = VK_NULL_HANDLE;
+}
+
+void StagingManager::uploadBuffer(VkBuffer destination, VkDeviceSize destinationOffset, const void* data, VkDeviceSize size, uint64_t graphicsValue)
+{
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        wasEmpty = mCollecting.empty();
+
+        VkBuffer source;
+        uint8_t* staging;
+        VkDeviceSize sourceOffset = reserve(size, 4, source, staging);
+        memcpy(staging, data, static_cast<size_t>(size));
+
+        BufferCopy copy = {};
+        copy.source = source;
+        copy.destination = destination;
+        copy.region.srcOffset = sourceOffset;
+        copy.region.dstOffset = destinationOffset;
+        copy.region.size = size;
+        mCollecting.bufferCopies.push_back(copy);
+        mCollecting.graphicsValue = std::max(mCollecting.graphicsValue, graphicsValue);
+
+        mStats.uploads++;
+        mStats.bytesUploaded += size;
+    }
+    uploadQueued(wasEmpty);
+}
+
+void StagingManager::uploadImage(VkImage destination, const VkImageSubresourceLayers& subresource, VkOffset3D offset, VkExtent3D extent,
+                                 const void* data, VkDeviceSize size, VkImageLayout finalLayout, VkImageLayout currentLayout, uint64_t graphicsValue)
+{
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        wasEmpty = mCollecting.empty();
+
+        // bufferOffset must be a multiple of 4 and of the texel size, 16 covers every uncompressed and block compressed format
+        VkBuffer source;
+        uint8_t* staging;
+        VkDeviceSize sourceOffset = reserve(size, 16, source, staging);
+        memcpy(staging, data, static_cast<size_t>(size));
+
+        ImageCopy copy = {};
+        copy.source = source;
+        copy.destination = destination;
+        copy.region.bufferOffset = sourceOffset;
+        copy.region.bufferRowLength = 0;            // Tightly packed
+        copy.region.bufferImageHeight = 0;
+        copy.region.imageSubresource = subresource;
+        copy.region.imageOffset = offset;
+        copy.region.imageExtent = extent;
+        copy.currentLayout = currentLayout;
+        copy.finalLayout = finalLayout;
+        mCollecting.imageCopies.push_back(copy);
+        mCollecting.graphicsValue = std::max(mCollecting.graphicsValue, graphicsValue);
+
+        // Kept contents belong to the graphics family, which has to release them before the transfer queue can write
+        mCollecting.needsRelease = mCollecting.needsRelease || (mTransferOwnership && currentLayout != VK_IMAGE_LAYOUT_UNDEFINED);
+
+        mStats.uploads++;
+        mStats.bytesUploaded += size;
+    }
+    uploadQueued(wasEmpty);
+}
+
+void StagingManager::uploadQueued(bool wasEmpty)
+{
+    // Only the first upload of a batch needs to ask for a frame, the rest go with it
+    if (wasEmpty && mUploadCallback)
+    {
+        mUploadCallback();
+    }
+}
+
+VkDeviceSize StagingManager::reserve(VkDeviceSize size, VkDeviceSize alignment, VkBuffer& buffer, uint8_t*& data)
+{
+    // Bigger than a chunk, gets a chunk of its own
+    if (size > mChunkSize)
+    {
+        Chunk chunk = createChunk(size);
+        chunk.head = size;
+        buffer = chunk.buffer;
+        data = chunk.allocation.mapped;
+
+        // Keep the chunk being filled last
+        std::vector<Chunk>& chunks = mCollecting.chunks;
+        chunks.insert(chunks.empty() ? chunks.end() : chunks.end() - 1, chunk);
+        return 0;
+    }
+
+    std::vector<Chunk>& chunks = mCollecting.chunks;
+    VkDeviceSize offset = 0;
+    if (!chunks.empty())
+    {
+        offset = (chunks.back().head + alignment - 1) / alignment * alignment;
+    }
+
+    if (chunks.empty() || offset + size > chunks.back().size)
+    {
+        if (!mFreeChunks.empty())
+        {
+            chunks.push_back(mFreeChunks.back());
+            mFreeChunks.pop_back();
+        }
+        else
+        {
+            chunks.push_back(createChunk(mChunkSize));
+        }
+        offset = 0;
+    }
+
+    Chunk& chunk = chunks.back();
+    chunk.head = offset + size;
+    buffer = chunk.buffer;
+    data = chunk.allocation.mapped + offset;
+    return offset;
+}
+
+StagingManager::Chunk StagingManager::createChunk(VkDeviceSize size)
+{
+    Chunk chunk;
+    chunk.size = size;
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (mDispatch->vkCreateBuffer(mDevice, &bufferInfo, mDispatch->allocator, &chunk.buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Staging Buffer!");
+    }
+
+    // Staging memory is coherent, so writes need no flush
+    chunk.allocation = mAllocator->allocateForBuffer(chunk.buffer, MemoryUsage::Staging);
+    return chunk;
+}
+
+void StagingManager::destroyChunk(Chunk& chunk)
+{
+    mDispatch->vkDestroyBuffer(mDevice, chunk.buffer, mDispatch->allocator);
+    mAllocator->free(chunk.allocation);
+    chunk = Chunk();
+}
+
+StagingManager::Batch& StagingManager::getFreeBatch()
+{
+    for (auto& batch : mBatches)
+    {
+        if (!batch.inFlight)
+            return batch;
+    }
+
+    Batch batch;
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = mQueueFamily;
+    if (mDispatch->vkCreateCommandPool(mDevice, &poolInfo, mDispatch->allocator, &batch.commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Staging Command Pool!");
+    }
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = batch.commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    if (mDispatch->vkAllocateCommandBuffers(mDevice, &allocInfo, &batch.commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate a Staging Command Buffer!");
+    }
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (mDispatch->vkCreateFence(mDevice, &fenceInfo, mDispatch->allocator, &batch.fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Staging Fence!");
+    }
+
+    mBatches.push_back(std::move(batch));
+    return mBatches.back();
+}
+
+uint64_t StagingManager::flush()
+{
+    // Closed at the end of the last frame, so everything it waits on has been submitted
+    uint64_t signalled = 0;
+    if (!mClosed.empty())
+    {
+        submit(mClosed);
+        mClosed = Collection();
+        signalled = mTimelineValue;
+    }
+
+    // Collected since then, only if it doesn't need a frame that hasn't been submitted yet (it's closed at the end of this one otherwise)
+    Collection collection;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mCollecting.empty() || mCollecting.needsRelease || mCollecting.graphicsValue > mGraphicsSubmitted)
+            return signalled;
+
+        collection = std::move(mCollecting);
+        mCollecting = Collection();
+    }
+
+    collection.transitions = getTransitions(collection.imageCopies);
+    submit(collection);
+    return mTimelineValue;
+}
+
+std::vector<StagingManager::ImageTransition> StagingManager::getTransitions(const std::vector<ImageCopy>& imageCopies) const
+{
+    // Every array layer of every mip level written, with the layout it starts in (first copy) and ends in (last copy)
+    std::map<std::tuple<VkImage, VkImageAspectFlags, uint32_t, uint32_t>, std::pair<VkImageLayout, VkImageLayout>> subresources;
+    for (const auto& copy : imageCopies)
+    {
+        const VkImageSubresourceLayers& layers = copy.region.imageSubresource;
+        for (uint32_t layer = layers.baseArrayLayer; layer < layers.baseArrayLayer + layers.layerCount; layer++)
+        {
+            auto key = std::make_tuple(copy.destination, layers.aspectMask, layers.mipLevel, layer);
+            auto it = subresources.find(key);
+            if (it == subresources.end())
+            {
+                subresources[key] = { copy.currentLayout, copy.finalLayout };
+            }
+            else
+            {
+                it->second.second = copy.finalLayout;
+            }
+        }
+    }
+
+    // Consecutive layers of a mip level in the same layouts share one barrier, anything not written is left alone
+    std::vector<ImageTransition> transitions;
+    for (const auto& subresource : subresources)
+    {
+        VkImage image = std::get<0>(subresource.first);
+        VkImageAspectFlags aspect = std::get<1>(subresource.first);
+        uint32_t mipLevel = std::get<2>(subresource.first);
+        uint32_t layer = std::get<3>(subresource.first);
+
+        if (!transitions.empty())
+        {
+            ImageTransition& last = transitions.back();
+            if (last.image == image && last.range.aspectMask == aspect && last.range.baseMipLevel == mipLevel
+                && last.range.baseArrayLayer + last.range.layerCount == layer
+                && last.currentLayout == subresource.second.first && last.finalLayout == subresource.second.second)
+            {
+                last.range.layerCount++;
+                continue;
+            }
+        }
+
+        transitions.push_back({ image, { aspect, mipLevel, 1, layer, 1 }, subresource.second.first, subresource.second.second });
+    }
+    return transitions;
+}
+
+void StagingManager::submit(Collection& collection)
+{
+    Batch& batch = getFreeBatch();
+    batch.chunks = std::move(collection.chunks);
+
+    mDispatch->vkResetCommandPool(mDevice, batch.commandPool, 0);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    mDispatch->vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+
+    uint32_t releaseFamily = mTransferOwnership ? mQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+    uint32_t acquireFamily = mTransferOwnership ? mGraphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+
+    // -- GROUP COPIES --
+    // One copy command per source/destination pair, with every region between them
+    std::map<std::pair<VkBuffer, VkBuffer>, std::vector<VkBufferCopy>> bufferGroups;
+    for (const auto& copy : collection.bufferCopies)
+    {
+        bufferGroups[{ copy.source, copy.destination }].push_back(copy.region);
+    }
+
+    std::map<std::pair<VkBuffer, VkImage>, std::vector<VkBufferImageCopy>> imageGroups;
+    for (const auto& copy : collection.imageCopies)
+    {
+        imageGroups[{ copy.source, copy.destination }].push_back(copy.region);
+    }
+
+    // -- RECORD --
+    // Written subresources into TRANSFER_DST, acquiring the ones the graphics queue released (kept contents on another family)
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    for (const auto& transition : collection.transitions)
+    {
+        bool acquire = mTransferOwnership && transition.currentLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = transition.currentLayout;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = acquire ? mGraphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = acquire ? mQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = transition.image;
+        barrier.subresourceRange = transition.range;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageBarriers.push_back(barrier);
+    }
+
+    // On the graphics queue, frames submitted earlier may still be reading the destinations, so wait for all of them
+    // (on another queue the graphics timeline wait below does that)
+    bool waitForFrames = mTimeline == VK_NULL_HANDLE && collection.graphicsValue != 0;
+    if (!imageBarriers.empty() || waitForFrames)
+    {
+        VkPipelineStageFlags srcStage = waitForFrames ? VK_PIPELINE_STAGE_ALL_COMMANDS_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        mDispatch->vkCmdPipelineBarrier(batch.commandBuffer, srcStage, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                        0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    }
+
+    for (const auto& group : bufferGroups)
+    {
+        mDispatch->vkCmdCopyBuffer(batch.commandBuffer, group.first.first, group.first.second,
+                                   static_cast<uint32_t>(group.second.size()), group.second.data());
+    }
+    for (const auto& group : imageGroups)
+    {
+        mDispatch->vkCmdCopyBufferToImage(batch.commandBuffer, group.first.first, group.first.second, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                          static_cast<uint32_t>(group.second.size()), group.second.data());
+    }
+
+    // Release images to the graphics family (if different) in their final layout
+    // When ownership moves, the graphics queue records a matching acquire (see recordGraphicsAcquire)
+    // Buffers are concurrent across the two families (see setBufferSharing), so they only need the semaphore
+    imageBarriers.clear();
+    for (const auto& transition : collection.transitions)
+    {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = transition.finalLayout;
+        barrier.srcQueueFamilyIndex = releaseFamily;
+        barrier.dstQueueFamilyIndex = acquireFamily;
+        barrier.image = transition.image;
+        barrier.subresourceRange = transition.range;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;                          // Visibility comes from the acquire, or the semaphore wait
+        imageBarriers.push_back(barrier);
+    }
+    if (!imageBarriers.empty())
+    {
+        mDispatch->vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                        0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    }
+
+    mDispatch->vkEndCommandBuffer(batch.commandBuffer);
+
+    // -- SUBMIT --
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+    // Overwrites wait for the frames reading the old contents (and releasing kept images) to finish
+    uint64_t waitValue = collection.graphicsValue;
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    uint64_t signalValue = mTimelineValue + 1;
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+    if (mTimeline != VK_NULL_HANDLE)
+    {
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &mTimeline;
+        if (waitValue != 0)
+        {
+            timelineInfo.waitSemaphoreValueCount = 1;
+            timelineInfo.pWaitSemaphoreValues = &waitValue;
+            submitInfo.waitSemaphoreCount = 1;
+            submitInfo.pWaitSemaphores = &mGraphicsTimeline;
+            submitInfo.pWaitDstStageMask = &waitStage;
+        }
+    }
+
+    mDispatch->vkResetFences(mDevice, 1, &batch.fence);
+    if (mDispatch->vkQueueSubmit(mQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit Staging Batch!");
+    }
+    batch.inFlight = true;
+    mTimelineValue = signalValue;
+
+    // Graphics side: acquire barriers when ownership moved, otherwise just a memory barrier on the same queue
+    if (mTransferOwnership && !imageBarriers.empty())
+    {
+        for (auto& barrier : imageBarriers)
+        {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        }
+        mPendingAcquires.push_back(std::move(imageBarriers));
+    }
+    if (mTimeline != VK_NULL_HANDLE)
+    {
+        mGraphicsWaitValue = mTimelineValue;
+    }
+    if (mTimeline == VK_NULL_HANDLE || !mTransferOwnership)
+    {
+        mBarrierPending = true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.batches++;
+        mStats.copyCommands += bufferGroups.size() + imageGroups.size();
+    }
+}
+
+StagingManager::GraphicsWait StagingManager::recordGraphicsAcquire(VkCommandBuffer commandBuffer)
+{
+    GraphicsWait wait;
+
+    for (const auto& imageBarriers : mPendingAcquires)
+    {
+        mDispatch->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                        0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    }
+    mPendingAcquires.clear();
+
+    // Same queue family: writes still need making visible to whatever reads them
+    if (mBarrierPending)
+    {
+        VkMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        mDispatch->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                        0, 1, &barrier, 0, nullptr, 0, nullptr);
+        mBarrierPending = false;
+    }
+
+    if (mGraphicsWaitValue != 0)
+    {
+        wait.semaphore = mTimeline;
+        wait.value = mGraphicsWaitValue;
+        wait.stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        mGraphicsWaitValue = 0;
+    }
+
+    return wait;
+}
+
+void StagingManager::recordGraphicsRelease(VkCommandBuffer commandBuffer, uint64_t value)
+{
+    Collection collection;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mGraphicsSubmitted = value;
+        if (mCollecting.empty())
+            return;
+
+        collection = std::move(mCollecting);
+        mCollecting = Collection();
+    }
+
+    // Only happens if a frame was recorded without a flush, what it closed waits on nothing later than this submit
+    if (!mClosed.empty())
+    {
+        submit(mClosed);
+        mClosed = Collection();
+    }
+
+    collection.transitions = getTransitions(collection.imageCopies);
+    if (collection.needsRelease)
+    {
+        // Layout change happens in the release/acquire pair, the batch's acquire (see submit) repeats these exactly
+        std::vector<VkImageMemoryBarrier> releaseBarriers;
+        for (const auto& transition : collection.transitions)
+        {
+            if (transition.currentLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+                continue;
+
+            VkImageMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.oldLayout = transition.currentLayout;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = mGraphicsFamily;
+            barrier.dstQueueFamilyIndex = mQueueFamily;
+            barrier.image = transition.image;
+            barrier.subresourceRange = transition.range;
+            barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            releaseBarriers.push_back(barrier);
+        }
+        mDispatch->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                        0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(releaseBarriers.size()), releaseBarriers.data());
+
+        // Transfer can't start until this submit has released them
+        collection.graphicsValue = std::max(collection.graphicsValue, value);
+    }
+    mClosed = std::move(collection);
+
+    // Submitted by the next frame's flush, so make sure there is one
+    if (mUploadCallback)
+    {
+        mUploadCallback();
+    }
+}
+
+StagingManager::GraphicsSignal StagingManager::getGraphicsSignal(uint64_t value) const
+{
+    GraphicsSignal signal;
+    signal.semaphore = mGraphicsTimeline;
+    signal.value = value;
+    return signal;
+}
+
+void StagingManager::collect()
+{
+    for (auto& batch : mBatches)
+    {
+        if (!batch.inFlight || mDispatch->vkGetFenceStatus(mDevice, batch.fence) != VK_SUCCESS)
+            continue;
+
+        batch.inFlight = false;
+
+        // Standard chunks go back in the free list, oversized ones are released
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& chunk : batch.chunks)
+        {
+            if (chunk.size == mChunkSize)
+            {
+                chunk.head = 0;
+                mFreeChunks.push_back(chunk);
+            }
+            else
+            {
+                destroyChunk(chunk);
+            }
+        }
+        batch.chunks.clear();
+    }
+}
+
+StagingManager::Stats StagingManager::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "DeviceDispatch.hpp"
+#include "GpuAllocator.hpp"
+
+// Collects buffer and image uploads from any thread and submits them in batches on the transfer queue
+// Copies to the same destination in a batch become one vkCmdCopyBuffer/vkCmdCopyBufferToImage with many regions
+// Each batch signals a timeline semaphore value, which the next graphics submit waits on, and waits in turn on the
+// graphics timeline for frames still reading what it overwrites
+// Without a separate transfer family (or timeline semaphores) batches go on the graphics queue, ordered by barriers instead
+class StagingManager
+{
+public:
+    // What the graphics submit that first uses the uploads has to wait on
+    struct GraphicsWait
+    {
+        VkSemaphore semaphore = VK_NULL_HANDLE;     // Timeline semaphore, VK_NULL_HANDLE if there is nothing to wait for
+        uint64_t value = 0;
+        VkPipelineStageFlags stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    };
+
+    // What every graphics submit signals, so batches can wait for the frames reading their destinations
+    struct GraphicsSignal
+    {
+        VkSemaphore semaphore = VK_NULL_HANDLE;     // Timeline semaphore, VK_NULL_HANDLE when batches share the graphics queue
+        uint64_t value = 0;
+    };
+
+    struct Stats
+    {
+        uint64_t uploads = 0;               // Upload requests
+        uint64_t copyCommands = 0;          // vkCmdCopy* calls they were coalesced into
+        uint64_t batches = 0;               // Submits
+        VkDeviceSize bytesUploaded = 0;
+    };
+
+    // transferQueue may be the graphics queue, queue family ownership is only transferred when the families differ
+    void init(GpuAllocator* allocator, const DeviceDispatch* dispatch, VkDevice device,
+              VkQueue transferQueue, uint32_t transferFamily, VkQueue graphicsQueue, uint32_t graphicsFamily,
+              bool timelineSemaphores, VkDeviceSize chunkSize = 8ull * 1024 * 1024);
+    void destroy();
+
+    // Called on the uploading thread when uploads are waiting for a frame to flush them (e.g. to wake an on demand render loop)
+    void setUploadCallback(std::function<void()> callback);
+
+    // Sharing for buffers written with uploadBuffer: concurrent between the graphics and transfer families when they differ,
+    // so a partial update never needs the rest of the buffer handed over with an ownership transfer
+    void setBufferSharing(VkBufferCreateInfo& bufferInfo) const;
+
+    // -- ANY THREAD --
+    // Data is copied into staging memory before returning, so it can be freed straight away
+    // graphicsValue is the graphics timeline value (see getGraphicsSignal) once frames reading the destination have finished,
+    // 0 if the graphics queue hasn't used it yet. The copy waits for it, so it never overwrites data a frame is still reading
+    void uploadBuffer(VkBuffer destination, VkDeviceSize destinationOffset, const void* data, VkDeviceSize size, uint64_t graphicsValue = 0);
+
+    // Only the subresources written are transitioned, from currentLayout, and left in finalLayout owned by the graphics queue family
+    // currentLayout UNDEFINED discards their previous contents, any other layout keeps them (the image must then be in that layout,
+    // owned by the graphics family, and the copy waits for a graphics submit to release it to the transfer queue)
+    void uploadImage(VkImage destination, const VkImageSubresourceLayers& subresource, VkOffset3D offset, VkExtent3D extent,
+                     const void* data, VkDeviceSize size, VkImageLayout finalLayout,
+                     VkImageLayout currentLayout = VK_IMAGE_LAYOUT_UNDEFINED, uint64_t graphicsValue = 0);
+
+    // -- RENDER THREAD --
+    // Submit uploads that are ready, returns the last timeline value signalled (0 if nothing was submitted)
+    // Uploads closed by the last recordGraphicsRelease go first, then those collected since if nothing they wait on is outstanding
+    uint64_t flush();
+
+    // Record what the graphics queue needs before it can use the uploads (ownership acquires, or a barrier),
+    // at the start of a graphics command buffer, and return what that submit must wait on
+    GraphicsWait recordGraphicsAcquire(VkCommandBuffer commandBuffer);
+
+    // At the end of the same command buffer: release images whose contents are kept to the transfer family, and close the
+    // uploads collected so far into a batch for the next flush (value is what this submit signals, see getGraphicsSignal)
+    void recordGraphicsRelease(VkCommandBuffer commandBuffer, uint64_t value);
+
+    // Semaphore for the graphics submit to signal with value, must be signalled by every submit passed to recordGraphicsRelease
+    GraphicsSignal getGraphicsSignal(uint64_t value) const;
+
+    // Free the staging memory of batches the GPU has finished
+    void collect();
+
+    Stats getStats() const;
+
+private:
+    struct Chunk
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        GpuAllocation allocation;
+        VkDeviceSize size = 0;
+        VkDeviceSize head = 0;
+    };
+
+    struct BufferCopy
+    {
+        VkBuffer source;
+        VkBuffer destination;
+        VkBufferCopy region;
+    };
+
+    struct ImageCopy
+    {
+        VkBuffer source;
+        VkImage destination;
+        VkBufferImageCopy region;
+        VkImageLayout currentLayout;
+        VkImageLayout finalLayout;
+    };
+
+    // Layout change of a run of array layers in one mip level, written by a batch
+    struct ImageTransition
+    {
+        VkImage image;
+        VkImageSubresourceRange range;
+        VkImageLayout currentLayout;
+        VkImageLayout finalLayout;
+    };
+
+    // Uploads that will go in one batch
+    struct Collection
+    {
+        std::vector<Chunk> chunks;                  // Last one is being filled
+        std::vector<BufferCopy> bufferCopies;
+        std::vector<ImageCopy> imageCopies;
+        std::vector<ImageTransition> transitions;   // Filled when the collection is closed
+        uint64_t graphicsValue = 0;                 // Graphics timeline value to wait for before copying
+        bool needsRelease = false;                  // Keeps image contents owned by the graphics family, so waits for a release
+
+        bool empty() const { return bufferCopies.empty() && imageCopies.empty(); }
+    };
+
+    struct Batch
+    {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;     // For recycling the batch on the CPU
+        std::vector<Chunk> chunks;
+        bool inFlight = false;
+    };
+
+    VkDeviceSize reserve(VkDeviceSize size, VkDeviceSize alignment, VkBuffer& buffer, uint8_t*& data);
+    Chunk createChunk(VkDeviceSize size);
+    void destroyChunk(Chunk& chunk);
+    Batch& getFreeBatch();
+    std::vector<ImageTransition> getTransitions(const std::vector<ImageCopy>& imageCopies) const;
+    void submit(Collection& collection);
+    void uploadQueued(bool wasEmpty);
+
+    GpuAllocator* mAllocator = nullptr;
+    const DeviceDispatch* mDispatch = nullptr;
+    VkDevice mDevice = VK_NULL_HANDLE;
+    VkQueue mQueue = VK_NULL_HANDLE;            // Queue batches are submitted to
+    uint32_t mQueueFamily = 0;
+    uint32_t mGraphicsFamily = 0;
+    uint32_t mSharedFamilies[2] = {};           // For concurrent buffers
+    bool mTransferOwnership = false;            // Batches run on another queue family
+    VkDeviceSize mChunkSize = 0;
+
+    VkSemaphore mTimeline = VK_NULL_HANDLE;
+    uint64_t mTimelineValue = 0;                // Last value signalled
+    uint64_t mGraphicsWaitValue = 0;            // Highest value the graphics queue hasn't waited on yet
+    bool mBarrierPending = false;               // Fallback path: batch on the graphics queue needs a barrier before use
+    VkSemaphore mGraphicsTimeline = VK_NULL_HANDLE;     // Signalled by graphics submits, waited on by batches
+    uint64_t mGraphicsSubmitted = 0;            // Last value passed to recordGraphicsRelease, submitted by the time flush runs
+
+    std::function<void()> mUploadCallback;
+
+    // Filled from any thread
+    mutable std::mutex mMutex;
+    Collection mCollecting;
+    std::vector<Chunk> mFreeChunks;             // Standard size chunks ready for reuse
+
+    Collection mClosed;                         // Closed by recordGraphicsRelease, submitted by the next flush
+    std::vector<Batch> mBatches;
+    std::vector<std::vector<VkImageMemoryBarrier>> mPendingAcquires;    // Ownership acquires the graphics queue still has to record
+    Stats mStats;
+};
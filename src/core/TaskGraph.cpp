@@ -0,0 +1,166 @@
+#include "TaskGraph.hpp"
+
+#include <stdexcept>
+
+TaskGraph::TaskId TaskGraph::add(const std::string& name, std::function<void()> work, const std::vector<TaskId>& dependencies, bool mainThreadOnly)
+{
+    TaskId id = mTasks.size();
+
+    Task task;
+    task.name = name;
+    task.work = std::move(work);
+    task.dependencyCount = dependencies.size();
+    task.mainThreadOnly = mainThreadOnly;
+    mTasks.push_back(std::move(task));
+
+    for (TaskId dependency : dependencies)
+    {
+        if (dependency >= id)
+        {
+            throw std::runtime_error("Task \"" + name + "\" depends on a task that hasn't been added yet!");
+        }
+        mTasks[dependency].dependents.push_back(id);
+    }
+
+    return id;
+}
+
+void TaskGraph::run(ThreadPool* pool, TraceRecorder* trace)
+{
+    // Tasks can only depend on earlier tasks, so insertion order is already a valid sequential order
+    if (pool == nullptr || pool->getThreadCount() == 0)
+    {
+        for (TaskId id = 0; id < mTasks.size(); id++)
+        {
+            execute(id, trace);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mRemainingDependencies.clear();
+    for (const auto& task : mTasks)
+    {
+        mRemainingDependencies.push_back(task.dependencyCount);
+    }
+    mMainThreadReady.clear();
+    mUnfinishedCount = mTasks.size();
+    mRunningCount = 0;
+    mFirstError = nullptr;
+
+    for (TaskId id = 0; id < mTasks.size(); id++)
+    {
+        if (mRemainingDependencies[id] == 0)
+        {
+            schedule(id, pool, trace);
+        }
+    }
+
+    // Main thread runs its own tasks as they become ready, until everything is finished (or stopped by an error)
+    while (true)
+    {
+        mChanged.wait(lock, [this]
+        {
+            return !mMainThreadReady.empty() || mUnfinishedCount == 0 || (mFirstError && mRunningCount == 0);
+        });
+
+        // After a failure, wait for running tasks without starting any more
+        if (mFirstError)
+        {
+            mMainThreadReady.clear();
+            if (mRunningCount == 0)
+                break;
+            continue;
+        }
+
+        if (mUnfinishedCount == 0)
+            break;
+
+        TaskId id = mMainThreadReady.back();
+        mMainThreadReady.pop_back();
+        mRunningCount++;
+
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            execute(id, trace);
+        } catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        finish(id, pool, trace, error);
+    }
+
+    if (mFirstError)
+    {
+        std::rethrow_exception(mFirstError);
+    }
+}
+
+void TaskGraph::execute(TaskId id, TraceRecorder* trace)
+{
+    if (trace == nullptr)
+    {
+        mTasks[id].work();
+        return;
+    }
+
+    ScopedTrace scopedTrace(*trace, mTasks[id].name.c_str());
+    mTasks[id].work();
+}
+
+// Must be called with mMutex held
+void TaskGraph::schedule(TaskId id, ThreadPool* pool, TraceRecorder* trace)
+{
+    if (mTasks[id].mainThreadOnly)
+    {
+        mMainThreadReady.push_back(id);
+        mChanged.notify_all();
+        return;
+    }
+
+    mRunningCount++;
+    pool->submit([this, id, pool, trace]
+    {
+        std::exception_ptr error;
+        try
+        {
+            execute(id, trace);
+        } catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        finish(id, pool, trace, error);
+    });
+}
+
+// Must be called with mMutex held
+void TaskGraph::finish(TaskId id, ThreadPool* pool, TraceRecorder* trace, std::exception_ptr error)
+{
+    mRunningCount--;
+    mUnfinishedCount--;
+
+    if (error && !mFirstError)
+    {
+        mFirstError = error;
+    }
+
+    // Release dependents, unless a failure means nothing else should start
+    if (!mFirstError)
+    {
+        for (TaskId dependent : mTasks[id].dependents)
+        {
+            if (--mRemainingDependencies[dependent] == 0)
+            {
+                schedule(dependent, pool, trace);
+            }
+        }
+    }
+
+    mChanged.notify_all();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.hpp"
+#include "TraceRecorder.hpp"
+
+// Set of jobs with dependencies between them. Jobs whose dependencies have finished run in parallel
+// on a thread pool, apart from jobs that must run on the calling thread (e.g. GLFW window creation)
+class TaskGraph
+{
+public:
+    using TaskId = size_t;
+
+    // Add a task that runs once every task in dependencies has finished (dependencies must already be added)
+    TaskId add(const std::string& name, std::function<void()> work, const std::vector<TaskId>& dependencies = {}, bool mainThreadOnly = false);
+
+    // Run every task and block until they are all done. With no pool, tasks run one after another on the calling thread
+    // If any task throws, no further tasks are started and the first exception is rethrown once running tasks finish
+    void run(ThreadPool* pool, TraceRecorder* trace = nullptr);
+
+private:
+    struct Task
+    {
+        std::string name;
+        std::function<void()> work;
+        std::vector<TaskId> dependents;     // Tasks waiting on this one
+        size_t dependencyCount = 0;
+        bool mainThreadOnly = false;
+    };
+
+    std::vector<Task> mTasks;
+
+    // - Run State
+    std::mutex mMutex;
+    std::condition_variable mChanged;
+    std::vector<size_t> mRemainingDependencies;
+    std::vector<TaskId> mMainThreadReady;
+    size_t mUnfinishedCount = 0;
+    size_t mRunningCount = 0;
+    std::exception_ptr mFirstError;
+
+    void execute(TaskId id, TraceRecorder* trace);
+    void schedule(TaskId id, ThreadPool* pool, TraceRecorder* trace);
+    void finish(TaskId id, ThreadPool* pool, TraceRecorder* trace, std::exception_ptr error);
+};
@@ -0,0 +1,157 @@
+#include "TextureUploader.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "MappedFile.hpp"
+
+void TextureUploader::init(const DeviceDispatch* dispatch, VkPhysicalDevice physicalDevice, VkDevice device, StagingManager* staging,
+                           bool hostImageCopy, const std::vector<VkImageLayout>& copyDstLayouts)
+{
+    mDispatch = dispatch;
+    mPhysicalDevice = physicalDevice;
+    mDevice = device;
+    mStaging = staging;
+    mHostImageCopy = hostImageCopy && mDispatch->vkCopyMemoryToImageEXT != nullptr && mDispatch->vkTransitionImageLayoutEXT != nullptr;
+    mCopyDstLayouts = copyDstLayouts;
+}
+
+VkImageUsageFlags TextureUploader::getImageUsage(VkFormat format, VkImageUsageFlags usage) const
+{
+    // Transfer destination is still needed in case the host path can't be used for a particular upload
+    usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if (mHostImageCopy && formatSupportsHostCopy(format) && hostCopyKeepsDeviceAccess(format, usage))
+    {
+        usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+    }
+    return usage;
+}
+
+bool TextureUploader::upload(VkImage image, VkFormat format, VkImageUsageFlags imageUsage, const VkImageSubresourceLayers& subresource,
+                             VkOffset3D offset, VkExtent3D extent, const void* data, VkDeviceSize size, VkImageLayout finalLayout)
+{
+    mBytes += size;
+
+    if (!canCopyOnHost(format, imageUsage, finalLayout))
+    {
+        mStaging->uploadImage(image, subresource, offset, extent, data, size, finalLayout);
+        mStagedCopies++;
+        return false;
+    }
+
+    // Straight into the final layout, the host copy writes it in place
+    VkHostImageLayoutTransitionInfoEXT transition = {};
+    transition.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT;
+    transition.image = image;
+    transition.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    transition.newLayout = finalLayout;
+    transition.subresourceRange.aspectMask = subresource.aspectMask;
+    transition.subresourceRange.baseMipLevel = subresource.mipLevel;
+    transition.subresourceRange.levelCount = 1;
+    transition.subresourceRange.baseArrayLayer = subresource.baseArrayLayer;
+    transition.subresourceRange.layerCount = subresource.layerCount;
+
+    if (mDispatch->vkTransitionImageLayoutEXT(mDevice, 1, &transition) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to transition Image Layout on the host!");
+    }
+
+    VkMemoryToImageCopyEXT region = {};
+    region.sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT;
+    region.pHostPointer = data;
+    region.memoryRowLength = 0;                 // Tightly packed
+    region.memoryImageHeight = 0;
+    region.imageSubresource = subresource;
+    region.imageOffset = offset;
+    region.imageExtent = extent;
+
+    VkCopyMemoryToImageInfoEXT copyInfo = {};
+    copyInfo.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT;
+    copyInfo.dstImage = image;
+    copyInfo.dstImageLayout = finalLayout;
+    copyInfo.regionCount = 1;
+    copyInfo.pRegions = &region;
+
+    if (mDispatch->vkCopyMemoryToImageEXT(mDevice, &copyInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to copy Memory to Image on the host!");
+    }
+
+    mHostCopies++;
+    return true;
+}
+
+bool TextureUploader::uploadFile(VkImage image, VkFormat format, VkImageUsageFlags imageUsage, const VkImageSubresourceLayers& subresource,
+                                 VkOffset3D offset, VkExtent3D extent, const std::string& path, size_t fileOffset, VkDeviceSize size,
+                                 VkImageLayout finalLayout)
+{
+    // Both paths copy out of the mapping before returning (host copy into the image, or memcpy into staging), so it can close straight away
+    MappedFile file;
+    if (!file.open(path) || fileOffset > file.getSize() || size > file.getSize() - fileOffset)
+    {
+        mFileFailures++;
+        throw std::runtime_error("Failed to map texture file \"" + path + "\"!");
+    }
+
+    return upload(image, format, imageUsage, subresource, offset, extent, file.getData() + fileOffset, size, finalLayout);
+}
+
+bool TextureUploader::isHostImageCopyEnabled() const
+{
+    return mHostImageCopy;
+}
+
+TextureUploader::Stats TextureUploader::getStats() const
+{
+    Stats stats;
+    stats.hostCopies = mHostCopies.load();
+    stats.stagedCopies = mStagedCopies.load();
+    stats.bytes = mBytes.load();
+    stats.fileFailures = mFileFailures.load();
+    return stats;
+}
+
+bool TextureUploader::canCopyOnHost(VkFormat format, VkImageUsageFlags imageUsage, VkImageLayout finalLayout) const
+{
+    // Images without host transfer usage (created before, or format unsupported) and layouts the host can't write in go through staging
+    return mHostImageCopy && (imageUsage & VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT)
+           && std::find(mCopyDstLayouts.begin(), mCopyDstLayouts.end(), finalLayout) != mCopyDstLayouts.end()
+           && formatSupportsHostCopy(format);
+}
+
+bool TextureUploader::formatSupportsHostCopy(VkFormat format) const
+{
+    VkFormatProperties3 formatProperties3 = {};
+    formatProperties3.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3;
+
+    VkFormatProperties2 formatProperties = {};
+    formatProperties.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2;
+    formatProperties.pNext = &formatProperties3;
+    vkGetPhysicalDeviceFormatProperties2(mPhysicalDevice, format, &formatProperties);
+
+    return (formatProperties3.optimalTilingFeatures & VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT_EXT) != 0;
+}
+
+bool TextureUploader::hostCopyKeepsDeviceAccess(VkFormat format, VkImageUsageFlags usage) const
+{
+    // Host transfer usage can make the driver pick a less optimal layout (e.g. no compression), which every later GPU read pays
+    // for, so the image is only given it if the device says access stays optimal
+    VkHostImageCopyDevicePerformanceQueryEXT performanceQuery = {};
+    performanceQuery.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_COPY_DEVICE_PERFORMANCE_QUERY_EXT;
+
+    VkImageFormatProperties2 imageFormatProperties = {};
+    imageFormatProperties.sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2;
+    imageFormatProperties.pNext = &performanceQuery;
+
+    VkPhysicalDeviceImageFormatInfo2 imageFormatInfo = {};
+    imageFormatInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2;
+    imageFormatInfo.format = format;
+    imageFormatInfo.type = VK_IMAGE_TYPE_2D;
+    imageFormatInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageFormatInfo.usage = usage | VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+
+    if (vkGetPhysicalDeviceImageFormatProperties2(mPhysicalDevice, &imageFormatInfo, &imageFormatProperties) != VK_SUCCESS)
+        return false;
+
+    return performanceQuery.optimalDeviceAccess == VK_TRUE;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "DeviceDispatch.hpp"
+#include "StagingManager.hpp"
+
+// Writes texture data into images, straight from host memory with VK_EXT_host_image_copy where the device and format allow it
+// (no staging buffer, no queue submission, runs on the calling thread), otherwise through the StagingManager
+// Thread safe, as long as each image is only uploaded to from one thread at a time
+class TextureUploader
+{
+public:
+    struct Stats
+    {
+        uint64_t hostCopies = 0;            // Written on the host
+        uint64_t stagedCopies = 0;          // Went through staging buffers and the transfer queue
+        uint64_t bytes = 0;
+        uint64_t fileFailures = 0;          // Files that couldn't be mapped or were too small
+    };
+
+    // copyDstLayouts are the layouts host copies can write in (VkPhysicalDeviceHostImageCopyPropertiesEXT), ignored without host copy
+    void init(const DeviceDispatch* dispatch, VkPhysicalDevice physicalDevice, VkDevice device, StagingManager* staging,
+              bool hostImageCopy, const std::vector<VkImageLayout>& copyDstLayouts);
+
+    // Usage to create an image with (2D, optimal tiling), adds host transfer where the format supports it so uploads can skip
+    // staging, unless the device reports that host transfer usage would slow down its own access to the image
+    VkImageUsageFlags getImageUsage(VkFormat format, VkImageUsageFlags usage) const;
+
+    // Replaces the region's contents (the rest of the subresource is discarded), leaving the image in finalLayout
+    // Image must have been created with getImageUsage and not be in use by the GPU
+    // Returns true if it was written on the host, false if it was queued on the staging manager (visible after the next frame's flush)
+    bool upload(VkImage image, VkFormat format, VkImageUsageFlags imageUsage, const VkImageSubresourceLayers& subresource,
+                VkOffset3D offset, VkExtent3D extent, const void* data, VkDeviceSize size, VkImageLayout finalLayout);
+
+    // Same, with the texels read from a file (size bytes at fileOffset), mapped rather than read so they're only copied once
+    bool uploadFile(VkImage image, VkFormat format, VkImageUsageFlags imageUsage, const VkImageSubresourceLayers& subresource,
+                    VkOffset3D offset, VkExtent3D extent, const std::string& path, size_t fileOffset, VkDeviceSize size,
+                    VkImageLayout finalLayout);
+
+    bool isHostImageCopyEnabled() const;
+    Stats getStats() const;
+
+private:
+    bool canCopyOnHost(VkFormat format, VkImageUsageFlags imageUsage, VkImageLayout finalLayout) const;
+    bool formatSupportsHostCopy(VkFormat format) const;
+    bool hostCopyKeepsDeviceAccess(VkFormat format, VkImageUsageFlags usage) const;
+
+    const DeviceDispatch* mDispatch = nullptr;
+    VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+    VkDevice mDevice = VK_NULL_HANDLE;
+    StagingManager* mStaging = nullptr;
+    bool mHostImageCopy = false;
+    std::vector<VkImageLayout> mCopyDstLayouts;
+
+    std::atomic<uint64_t> mHostCopies{ 0 };
+    std::atomic<uint64_t> mStagedCopies{ 0 };
+    std::atomic<uint64_t> mBytes{ 0 };
+    std::atomic<uint64_t> mFileFailures{ 0 };
+};
@@ -0,0 +1,74 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        mThreads.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mJobAvailable.notify_all();
+
+    // Workers finish the jobs already queued before they exit
+    for (auto& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.push_back(std::move(job));
+    }
+    mJobAvailable.notify_one();
+}
+
+void ThreadPool::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [this] { return mJobs.empty() && mActiveJobs == 0; });
+}
+
+size_t ThreadPool::getThreadCount() const
+{
+    return mThreads.size();
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mJobAvailable.wait(lock, [this] { return mStopping || !mJobs.empty(); });
+
+            if (mJobs.empty())
+                return;
+
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+            mActiveJobs++;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mActiveJobs--;
+            if (mJobs.empty() && mActiveJobs == 0)
+            {
+                mIdle.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#include "TraceRecorder.hpp"
+
+#include <cstdio>
+
+TraceRecorder::TraceRecorder()
+{
+    mStartTime = Clock::now();
+}
+
+void TraceRecorder::record(const std::string& name, const std::string& category, Clock::time_point start, Clock::time_point end)
+{
+    Event event;
+    event.name = name;
+    event.category = category;
+    event.startMicroseconds = getMicrosecondsSinceStart(start);
+    event.durationMicroseconds = std::chrono::duration<double, std::micro>(end - start).count();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // Give each new thread the next id
+    auto threadId = mThreadIds.emplace(std::this_thread::get_id(), static_cast<uint32_t>(mThreadIds.size()));
+    event.threadId = threadId.first->second;
+
+    mEvents.push_back(event);
+}
+
+static std::string escapeJson(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            // Control characters aren't allowed raw in JSON strings
+            char code[7];
+            snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+            escaped += code;
+        }
+        else
+        {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+bool TraceRecorder::writeChromeTrace(const std::string& path) const
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+        return false;
+
+    std::vector<Event> events = getEvents();
+
+    // Complete ("X") events carry their own duration, so no begin/end pairs are needed
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        const Event& event = events[i];
+        fprintf(file, "  {\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}%s\n",
+                escapeJson(event.name).c_str(), escapeJson(event.category).c_str(),
+                event.startMicroseconds, event.durationMicroseconds, event.threadId,
+                i + 1 < events.size() ? "," : "");
+    }
+    fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+
+    return fclose(file) == 0;
+}
+
+std::vector<TraceRecorder::Event> TraceRecorder::getEvents() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEvents;
+}
+
+double TraceRecorder::getMicrosecondsSinceStart(Clock::time_point time) const
+{
+    return std::chrono::duration<double, std::micro>(time - mStartTime).count();
+}
+
+ScopedTrace::ScopedTrace(TraceRecorder& recorder, const char* name, const char* category)
+    : mRecorder(recorder), mName(name), mCategory(category)
+{
+    mStart = TraceRecorder::Clock::now();
+}
+
+ScopedTrace::~ScopedTrace()
+{
+    mRecorder.record(mName, mCategory, mStart, TraceRecorder::Clock::now());
+}
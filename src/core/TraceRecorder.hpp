@@ -0,0 +1,59 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <map>
+
+// Records how long named stages take, and writes them out in the Chrome trace event format
+// (load the file in chrome://tracing or https://ui.perfetto.dev)
+class TraceRecorder
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Event
+    {
+        std::string name;
+        std::string category;
+        double startMicroseconds;   // Relative to when the recorder was created
+        double durationMicroseconds;
+        uint32_t threadId;          // Small sequential id, so threads are easy to tell apart in the viewer
+    };
+
+    TraceRecorder();
+
+    // Add a completed stage (thread safe)
+    void record(const std::string& name, const std::string& category, Clock::time_point start, Clock::time_point end);
+
+    // Write all recorded events as a Chrome trace JSON file, returns false if the file couldn't be written
+    bool writeChromeTrace(const std::string& path) const;
+
+    std::vector<Event> getEvents() const;
+    double getMicrosecondsSinceStart(Clock::time_point time) const;
+
+private:
+    Clock::time_point mStartTime;
+    mutable std::mutex mMutex;
+    std::vector<Event> mEvents;
+    std::map<std::thread::id, uint32_t> mThreadIds;
+};
+
+// Records the time between construction and destruction as a single trace event
+class ScopedTrace
+{
+public:
+    ScopedTrace(TraceRecorder& recorder, const char* name, const char* category = "init");
+    ~ScopedTrace();
+
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+private:
+    TraceRecorder& mRecorder;
+    const char* mName;
+    const char* mCategory;
+    TraceRecorder::Clock::time_point mStart;
+};
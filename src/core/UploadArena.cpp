@@ -0,0 +1,123 @@
+#include "UploadArena.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+void UploadArena::init(GpuAllocator* allocator, const DeviceDispatch* dispatch, VkDevice device, VkDeviceSize capacity,
+                       VkDeviceSize alignment, VkBufferUsageFlags usage)
+{
+    mAllocator = allocator;
+    mDispatch = dispatch;
+    mDevice = device;
+    mCapacity = capacity;
+    mAlignment = std::max<VkDeviceSize>(1, alignment);
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = capacity;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (mDispatch->vkCreateBuffer(mDevice, &bufferInfo, mDispatch->allocator, &mBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create an Upload Arena Buffer!");
+    }
+
+    // Mapped for its whole lifetime, so a frame's uploads never call vkMapMemory
+    mAllocation = mAllocator->allocateForBuffer(mBuffer, MemoryUsage::Upload);
+    if (mAllocation.mapped == nullptr)
+    {
+        throw std::runtime_error("Failed to map Upload Arena memory!");
+    }
+
+    // Fixed for the buffer's lifetime, so each allocation's address is just an offset from it
+    mAddress = 0;
+    if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+    {
+        VkBufferDeviceAddressInfo addressInfo = {};
+        addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+        addressInfo.buffer = mBuffer;
+        mAddress = mDispatch->vkGetBufferDeviceAddress(mDevice, &addressInfo);
+    }
+
+    mStats = Stats();
+    mStats.capacity = capacity;
+}
+
+void UploadArena::destroy()
+{
+    if (mBuffer == VK_NULL_HANDLE)
+        return;
+
+    mDispatch->vkDestroyBuffer(mDevice, mBuffer, mDispatch->allocator);
+    mAllocator->free(mAllocation);
+    mBuffer = VK_NULL_HANDLE;
+}
+
+void UploadArena::reset()
+{
+    mStats.highWater = std::max(mStats.highWater, mHead);
+    mHead = 0;
+    mFlushed = 0;
+}
+
+UploadArena::Allocation UploadArena::allocate(VkDeviceSize size)
+{
+    return allocate(size, mAlignment);
+}
+
+UploadArena::Allocation UploadArena::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    Allocation allocation;
+
+    VkDeviceSize offset = (mHead + alignment - 1) / alignment * alignment;
+    if (offset + size > mCapacity)
+    {
+        mStats.overflows++;
+        return allocation;
+    }
+
+    mHead = offset + size;
+
+    allocation.buffer = mBuffer;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.data = mAllocation.mapped + offset;
+    allocation.address = mAddress != 0 ? mAddress + offset : 0;
+    return allocation;
+}
+
+UploadArena::Allocation UploadArena::write(const void* data, VkDeviceSize size)
+{
+    Allocation allocation = allocate(size);
+    if (allocation.data != nullptr)
+    {
+        memcpy(allocation.data, data, static_cast<size_t>(size));
+    }
+    return allocation;
+}
+
+void UploadArena::flush()
+{
+    // Only what was written since the last flush, allocator widens it to nonCoherentAtomSize
+    if (mHead > mFlushed)
+    {
+        mAllocator->flush(mAllocation, mFlushed, mHead - mFlushed);
+        mFlushed = mHead;
+    }
+
+    // Everything the frame allocates has been written by the time it's flushed for submit
+    mStats.usedLastFrame = mHead;
+    mStats.highWater = std::max(mStats.highWater, mHead);
+}
+
+VkBuffer UploadArena::getBuffer() const
+{
+    return mBuffer;
+}
+
+UploadArena::Stats UploadArena::getStats() const
+{
+    return mStats;
+}
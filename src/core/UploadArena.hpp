@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+#include "DeviceDispatch.hpp"
+#include "GpuAllocator.hpp"
+
+// Linear allocator over one persistently mapped, host visible buffer, used for data written every frame
+// (uniforms, dynamic vertices, instance data). One per frame in flight: allocation is a pointer bump,
+// and the whole buffer is recycled at once when that frame's fence has signalled
+class UploadArena
+{
+public:
+    struct Allocation
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;        // Dynamic offset to bind with, or copy source offset
+        VkDeviceSize size = 0;
+        void* data = nullptr;           // Write here, nullptr if the arena was full
+        VkDeviceAddress address = 0;    // For shaders to read through, 0 unless usage has SHADER_DEVICE_ADDRESS
+    };
+
+    struct Stats
+    {
+        VkDeviceSize capacity = 0;
+        VkDeviceSize usedLastFrame = 0;     // Used by the frame last flushed, recorded at flush so it's current once submitted
+        VkDeviceSize highWater = 0;     // Most used in any frame
+        uint64_t overflows = 0;         // Allocations that didn't fit
+    };
+
+    // alignment covers every way the buffer is bound (uniform/storage offset alignment), usage is what it's bound as
+    void init(GpuAllocator* allocator, const DeviceDispatch* dispatch, VkDevice device, VkDeviceSize capacity,
+              VkDeviceSize alignment, VkBufferUsageFlags usage);
+    void destroy();
+
+    // Frame's fence has signalled, so the GPU is done with everything allocated last time
+    void reset();
+
+    Allocation allocate(VkDeviceSize size);
+    Allocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+    // Copy data in, returns the allocation to bind (data is nullptr if it didn't fit)
+    Allocation write(const void* data, VkDeviceSize size);
+
+    // Before submitting: make this frame's writes visible to the GPU (only does anything for non-coherent memory)
+    void flush();
+
+    VkBuffer getBuffer() const;
+    Stats getStats() const;
+
+private:
+    GpuAllocator* mAllocator = nullptr;
+    const DeviceDispatch* mDispatch = nullptr;
+    VkDevice mDevice = VK_NULL_HANDLE;
+
+    VkBuffer mBuffer = VK_NULL_HANDLE;
+    GpuAllocation mAllocation;
+    VkDeviceAddress mAddress = 0;
+    VkDeviceSize mCapacity = 0;
+    VkDeviceSize mAlignment = 1;
+    VkDeviceSize mHead = 0;             // Next free byte
+    VkDeviceSize mFlushed = 0;          // Bytes already flushed this frame
+
+    Stats mStats;
+};
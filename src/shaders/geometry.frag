@@ -0,0 +1,10 @@
+#version 460
+
+layout(location = 0) in vec4 fragColour;
+
+layout(location = 0) out vec4 outColour;
+
+void main()
+{
+    outColour = fragColour;
+}
@@ -0,0 +1,49 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+// Vertex pulling: no vertex input state, positions are read through buffer device addresses passed in push constants
+// Index buffer isn't bound either, the draw is non-indexed and gl_VertexIndex walks the index list
+
+struct Vertex
+{
+    vec2 position;
+    uint colour;        // RGBA8
+    uint padding;
+};
+
+struct Instance
+{
+    vec2 offset;
+    float scale;
+    float rotation;     // Radians
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer VertexBuffer { Vertex vertices[]; };
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer IndexBuffer { uint indices[]; };
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer InstanceBuffer { Instance instances[]; };
+
+// Must match GeometryPushConstants in Utilities.hpp
+layout(push_constant) uniform PushConstants
+{
+    VertexBuffer vertexBuffer;
+    IndexBuffer indexBuffer;
+    InstanceBuffer instanceBuffer;
+    float aspect;       // Height / width of the scene, keeps shapes square
+} pc;
+
+layout(location = 0) out vec4 fragColour;
+
+void main()
+{
+    uint index = pc.indexBuffer.indices[gl_VertexIndex];
+    Vertex vertex = pc.vertexBuffer.vertices[index];
+    Instance instance = pc.instanceBuffer.instances[gl_InstanceIndex];
+
+    float s = sin(instance.rotation);
+    float c = cos(instance.rotation);
+    vec2 position = mat2(c, s, -s, c) * vertex.position * instance.scale;
+    position.x *= pc.aspect;
+
+    gl_Position = vec4(position + instance.offset, 0.0, 1.0);
+    fragColour = unpackUnorm4x8(vertex.colour);
+}